@@ -0,0 +1,183 @@
+/**
+ * Implementation of an arena (bump-pointer) allocator.
+ */
+
+#include <stdlib.h>
+#include "arena.h"
+
+/* Every allocation is aligned to the size of this union */
+typedef union
+{
+    long l;
+    double d;
+    void* p;
+} MaxAlign;
+
+#define ALIGNMENT sizeof(MaxAlign)
+
+/* Rounds a size up to the next multiple of ALIGNMENT */
+#define ALIGN(size) (((size) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT)
+
+/* Space taken by the ArenaBlock struct at the start of each block */
+#define HEADER_SIZE ALIGN(sizeof(ArenaBlock))
+
+static ArenaBlock* Arena_addBlock(Arena* arena, size_t size);
+
+static void freeBlocks(ArenaBlock* block);
+
+/**
+ * Allocates enough memory for an empty Arena and initialises all fields to
+ * their default values and returns the Arena.
+ *
+ * Parameters:
+ *  blockSize - the number of bytes in each block of the Arena
+ * Returns:
+ *  arena - an empty Arena, or NULL if the memory could not be allocated
+ */
+Arena* Arena_create(size_t blockSize)
+{
+    Arena* arena = (Arena*) malloc(sizeof(Arena));
+
+    if (arena != NULL)
+    {
+        arena->head = NULL;
+        arena->spare = NULL;
+        arena->blockSize = blockSize;
+        arena->numAllocations = 0;
+        arena->numBlocks = 0;
+    }
+
+    return arena;
+}
+
+/**
+ * Hands out 'size' bytes from the current block, starting a new block when it
+ * is full. Allocations larger than a block get a block of their own.
+ *
+ * Parameters:
+ *  arena - the Arena to allocate from
+ *  size  - the number of bytes to allocate
+ * Returns:
+ *  a pointer to the memory, or NULL if it could not be allocated
+ */
+void* Arena_alloc(Arena* arena, size_t size)
+{
+    ArenaBlock* block = arena->head;
+    void* memory = NULL;
+
+    size = ALIGN(size);
+    if (block == NULL || block->size - block->used < size)
+    {
+        block = Arena_addBlock(arena, size > arena->blockSize ? size : arena->blockSize);
+    }
+
+    if (block != NULL)
+    {
+        memory = (char*) block + HEADER_SIZE + block->used;
+        block->used += size;
+        (arena->numAllocations)++;
+    }
+
+    return memory;
+}
+
+/**
+ * Hands back every allocation made from the Arena at once, keeping its blocks
+ * to be used again by the allocations which follow, so an Arena which is reset
+ * and filled again each time stops calling malloc once it has grown large
+ * enough.
+ *
+ * Parameters:
+ *  arena - the Arena to reset
+ */
+void Arena_reset(Arena* arena)
+{
+    ArenaBlock* next;
+    ArenaBlock* block;
+
+    block = arena->head;
+    while (block != NULL)
+    {
+        next = block->next;
+        block->next = arena->spare;
+        block->used = 0;
+        arena->spare = block;
+        block = next;
+    }
+    arena->head = NULL;
+    arena->numAllocations = 0;
+    arena->numBlocks = 0;
+}
+
+/**
+ * Releases every block of the Arena, and with them every allocation ever made
+ * from it, as well as the Arena itself.
+ *
+ * Parameters:
+ *  arena - the Arena to free
+ */
+void Arena_free(Arena* arena)
+{
+    if (arena != NULL)
+    {
+        freeBlocks(arena->head);
+        freeBlocks(arena->spare);
+        free(arena);
+    }
+}
+
+/**
+ * A private function that makes a block of at least 'size' bytes the current
+ * block, taking the first spare block which is large enough or otherwise
+ * mallocing a new one.
+ *
+ * Returns:
+ *  block - the new block, or NULL if the memory could not be allocated
+ */
+static ArenaBlock* Arena_addBlock(Arena* arena, size_t size)
+{
+    ArenaBlock* block;
+    ArenaBlock** link;
+
+    link = &(arena->spare);
+    while (*link != NULL && (*link)->size < size)
+    {
+        link = &((*link)->next);
+    }
+    block = *link;
+    if (block != NULL)
+    {
+        *link = block->next;
+        size = block->size;
+    }
+    else
+    {
+        block = (ArenaBlock*) malloc(HEADER_SIZE + size);
+    }
+
+    if (block != NULL)
+    {
+        block->next = arena->head;
+        block->size = size;
+        block->used = 0;
+        arena->head = block;
+        (arena->numBlocks)++;
+    }
+
+    return block;
+}
+
+/**
+ * A private function that frees a list of blocks.
+ */
+static void freeBlocks(ArenaBlock* block)
+{
+    ArenaBlock* next;
+
+    while (block != NULL)
+    {
+        next = block->next;
+        free(block);
+        block = next;
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/**
+ * A struct representing one block of memory in an Arena. The memory handed out
+ * by the Arena follows the struct.
+ */
+typedef struct ArenaBlock
+{
+    struct ArenaBlock* next;
+    size_t size;
+    size_t used;
+} ArenaBlock;
+
+/**
+ * A struct representing an arena (bump-pointer) allocator. Memory is handed out
+ * from large blocks by moving a pointer along, and is never freed on its own;
+ * every block is released at once by Arena_free. Arena_reset instead keeps the
+ * blocks as spares, which are used again before any new block is malloced. The
+ * counters record how many allocations were made and how many blocks they
+ * needed since the Arena was created or reset.
+ */
+typedef struct
+{
+    ArenaBlock* head;
+    ArenaBlock* spare;
+    size_t blockSize;
+    long numAllocations;
+    long numBlocks;
+} Arena;
+
+Arena* Arena_create(size_t blockSize);
+
+void* Arena_alloc(Arena* arena, size_t size);
+
+void Arena_reset(Arena* arena);
+
+void Arena_free(Arena* arena);
+
+#endif
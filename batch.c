@@ -0,0 +1,431 @@
+/**
+ * Implementation of batch drawing, which draws many input files in one run on
+ * a fixed pool of threads instead of starting the program once for each. Every
+ * file is drawn the same way as a run of its own, with its own TurtleSettings,
+ * Canvas and Terminal, into an output file named after it, so the threads share
+ * nothing while drawing. Each drawing reads and renders with a single thread,
+ * as the files are drawn side by side instead. The records a drawing logs are
+ * kept in a temporary file and added to the log file in one piece when it
+ * finishes, so its run in the log is never mixed up with another's. Its error
+ * messages are kept the same way and printed together, ending with the name of
+ * the file they belong to.
+ */
+
+/* pthreads are POSIX, not C89 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+#include "boolean.h"
+#include "batch.h"
+#include "utils.h"
+
+/* Number of file names the list read from a manifest starts with, which it
+ * doubles from when full */
+#define INITIAL_NAMES 64
+
+/**
+ * A struct representing a batch being drawn. The threads take the next file to
+ * draw from 'nextFile', and write its status to the same place in 'statuses'.
+ * The lock is held while taking a file, and while adding to the log file and
+ * the statistics.
+ */
+typedef struct
+{
+    char** fileNames;
+    int numFiles;
+    int* statuses;
+    Options* options;
+    FILE* logFile;
+    int nextFile;
+    pthread_mutex_t lock;
+} Batch;
+
+static int readManifest(char* fileName, char*** fileNames, int* numFiles);
+
+static void* Batch_run(void* data);
+
+static int drawFile(Batch* batch, char* fileName);
+
+/**
+ * Draws each input file into a file named with the batch suffix added, as an
+ * image when the suffix is the extension of one and as the terminal's escape
+ * codes otherwise, using one thread per processor unless --threads is given.
+ * The status of every file, the same error code a run of its own would return,
+ * is printed to stdout in the order the files were given.
+ *
+ * Parameters:
+ *  fileNames - the input files named on the command line
+ *  numFiles  - the number of input files named on the command line
+ *  options   - the options given on the command line
+ * Returns:
+ *  the first status which is not 0, or 1 if the manifest or the log file could
+ *  not be opened, please see readCommandsFromFile() in fileIO.c for details
+ */
+int renderBatch(char** fileNames, int numFiles, Options* options)
+{
+    int errNo;
+    Batch batch;
+    char** listed;
+    int numListed;
+    pthread_t threads[MAX_THREADS];
+    int numThreads, numStarted;
+    int ii;
+
+    errNo = 0;
+    listed = NULL;
+    numListed = 0;
+    if (options->manifestName != NULL)
+    {
+        errNo = readManifest(options->manifestName, &listed, &numListed);
+    }
+
+    batch.fileNames = NULL;
+    batch.statuses = NULL;
+    batch.logFile = NULL;
+    if (errNo == 0)
+    {
+        batch.numFiles = numFiles + numListed;
+        batch.fileNames = (char**) malloc((batch.numFiles + 1) * sizeof(char*));
+        batch.statuses = (int*) calloc(batch.numFiles + 1, sizeof(int));
+        if (batch.fileNames == NULL || batch.statuses == NULL)
+        {
+            errNo = 3; /* System error */
+            fprintf(stderr, "ERROR: Could not allocate memory for the file names.\n");
+        }
+    }
+    if (errNo == 0)
+    {
+        batch.logFile = fopen(options->isBinaryLog ? BINARY_LOG_NAME : TEXT_LOG_NAME,
+                              options->isBinaryLog ? "ab" : "a");
+        if (batch.logFile == NULL)
+        {
+            errNo = 1; /* File could not be opened */
+            perror("ERROR: The log file could not be opened");
+        }
+    }
+
+    if (errNo == 0 && pthread_mutex_init(&batch.lock, NULL) == 0)
+    {
+        memcpy(batch.fileNames, fileNames, numFiles * sizeof(char*));
+        if (numListed > 0)
+        {
+            memcpy(batch.fileNames + numFiles, listed, numListed * sizeof(char*));
+        }
+        batch.options = options;
+        batch.nextFile = 0;
+        /* The hot path counters are shared, so are not kept */
+        stats.hasCounters = FALSE;
+
+        /* The calling thread draws too, and no more threads start than there
+         * are files */
+        numThreads = getNumThreads(options->numThreads);
+        numStarted = 0;
+        for (ii = 1; ii < numThreads && ii < batch.numFiles &&
+                     numStarted == ii - 1; ii++)
+        {
+            if (pthread_create(&threads[numStarted], NULL, &Batch_run, &batch) == 0)
+            {
+                numStarted++;
+            }
+        }
+        Batch_run(&batch);
+        for (ii = 0; ii < numStarted; ii++)
+        {
+            pthread_join(threads[ii], NULL);
+        }
+        pthread_mutex_destroy(&batch.lock);
+
+        for (ii = 0; ii < batch.numFiles; ii++)
+        {
+            printf("%d %s\n", batch.statuses[ii], batch.fileNames[ii]);
+            if (errNo == 0)
+            {
+                errNo = batch.statuses[ii];
+            }
+        }
+    }
+    else if (errNo == 0)
+    {
+        errNo = 3; /* System error */
+        fprintf(stderr, "ERROR: Could not start drawing the files.\n");
+    }
+
+    if (batch.logFile != NULL && fclose(batch.logFile) != 0)
+    {
+        perror("ERROR: The file was not closed successfully");
+    }
+    for (ii = 0; ii < numListed; ii++)
+    {
+        free(listed[ii]);
+    }
+    free(listed);
+    free(batch.fileNames);
+    free(batch.statuses);
+
+    return errNo;
+}
+
+/**
+ * A private function that reads the input files listed in a manifest, one on
+ * each line. Whitespace around each name is ignored, as are blank lines.
+ *
+ * Parameters:
+ *  fileName  - the name of the manifest, or "-" for stdin
+ *  fileNames - (export) the file names listed, each allocated on its own
+ *  numFiles  - (export) the number of file names listed
+ * Returns:
+ *  0 on success, 1 if the manifest could not be opened, 2 if it could not be
+ *  closed, or 3 if it could not be read
+ */
+static int readManifest(char* fileName, char*** fileNames, int* numFiles)
+{
+    int errNo = 0;
+    LineReader* reader;
+    char* line;
+    int length, capacity;
+    char** names;
+
+    *fileNames = NULL;
+    *numFiles = 0;
+    capacity = 0;
+    reader = LineReader_open(fileName);
+    if (reader != NULL)
+    {
+        while (errNo == 0 && LineReader_next(reader, &line, &length))
+        {
+            while (length > 0 && isspace((unsigned char) line[length - 1]))
+            {
+                length--;
+            }
+            while (length > 0 && isspace((unsigned char) line[0]))
+            {
+                line++;
+                length--;
+            }
+
+            if (length > 0 && *numFiles == capacity)
+            {
+                capacity = capacity == 0 ? INITIAL_NAMES : capacity * 2;
+                names = (char**) realloc(*fileNames, capacity * sizeof(char*));
+                if (names != NULL)
+                {
+                    *fileNames = names;
+                }
+                else
+                {
+                    errNo = 3; /* System error */
+                }
+            }
+            if (length > 0 && errNo == 0)
+            {
+                (*fileNames)[*numFiles] = (char*) malloc(length + 1);
+                if ((*fileNames)[*numFiles] != NULL)
+                {
+                    memcpy((*fileNames)[*numFiles], line, length);
+                    (*fileNames)[*numFiles][length] = '\0';
+                    (*numFiles)++;
+                }
+                else
+                {
+                    errNo = 3; /* System error */
+                }
+            }
+        }
+
+        if (errNo != 0)
+        {
+            fprintf(stderr, "ERROR: Could not allocate memory for the file names.\n");
+        }
+        else if (reader->isError)
+        {
+            errNo = 3; /* System error */
+            perror("ERROR: The manifest could not be read");
+        }
+        if (LineReader_close(reader) != 0)
+        {
+            errNo = 2; /* Error closing file */
+            perror("ERROR: The manifest was not closed successfully");
+        }
+    }
+    else
+    {
+        errNo = 1; /* File could not be opened */
+        perror("ERROR: The manifest could not be opened");
+    }
+
+    return errNo;
+}
+
+/**
+ * A private function run by each thread of the batch, which draws the next file
+ * not yet taken until there are none left.
+ *
+ * Parameters:
+ *  data - the Batch being drawn
+ * Returns:
+ *  NULL
+ */
+static void* Batch_run(void* data)
+{
+    Batch* batch = (Batch*) data;
+    int index;
+
+    do
+    {
+        pthread_mutex_lock(&batch->lock);
+        index = batch->nextFile;
+        if (index < batch->numFiles)
+        {
+            (batch->nextFile)++;
+        }
+        pthread_mutex_unlock(&batch->lock);
+
+        if (index < batch->numFiles)
+        {
+            batch->statuses[index] = drawFile(batch, batch->fileNames[index]);
+        }
+    }
+    while (index < batch->numFiles);
+
+    return NULL;
+}
+
+/**
+ * A private function that draws one file of the batch the same way as a run of
+ * its own, except that -O does not print how many commands it removed. The
+ * log and the error messages are written to temporary files, which are added
+ * to the log file and printed to stderr once the drawing is finished.
+ *
+ * Parameters:
+ *  batch    - the Batch being drawn
+ *  fileName - the name of the input file
+ * Returns:
+ *  the error code a run of its own would return, or 1 if the output file
+ *  could not be opened, please see readCommandsFromFile() in fileIO.c for
+ *  details
+ */
+static int drawFile(Batch* batch, char* fileName)
+{
+    int errNo;
+    Options options;
+    Stats runStats;
+    Sink sink;
+    Program* program;
+    char* outputName;
+    FILE* output;
+    FILE* runLog;
+    FILE* runErrors;
+    double start;
+    int isDrawn;
+
+    errNo = 0;
+    options = *(batch->options);
+    /* The files are drawn side by side instead */
+    options.numThreads = 1;
+    memset(&runStats, 0, sizeof(Stats));
+    output = NULL;
+    outputName = (char*) malloc(strlen(fileName) + strlen(options.batchSuffix) + 1);
+    runLog = tmpfile();
+    runErrors = tmpfile();
+    if (outputName == NULL)
+    {
+        errNo = 3; /* System error */
+        fprintf(stderr, "ERROR: Could not allocate memory for the output file name.\n");
+    }
+    else if (runLog == NULL || runErrors == NULL)
+    {
+        errNo = 3; /* System error */
+        perror("ERROR: The log could not be written");
+    }
+    else
+    {
+        strcpy(outputName, fileName);
+        strcat(outputName, options.batchSuffix);
+
+        start = Stats_getTime();
+        program = NULL;
+        errNo = loadProgram(fileName, &program, &options, runErrors);
+        if (errNo == 0 && options.optimiseLevel != OPTIMISE_OFF)
+        {
+            runStats.commandsRemoved = optimiseProgram(program, options.optimiseLevel);
+        }
+        runStats.times[PHASE_READ] = Stats_getTime() - start;
+
+        if (errNo == 0)
+        {
+            if (Image_isImageName(outputName))
+            {
+                options.outputName = outputName;
+            }
+            else
+            {
+                output = fopen(outputName, "w");
+                if (output == NULL)
+                {
+                    errNo = 1; /* File could not be opened */
+                    printSystemError(runErrors, "ERROR: The output file could not "
+                                     "be opened");
+                }
+            }
+        }
+
+        isDrawn = errNo == 0;
+        if (isDrawn)
+        {
+            sink.output = output;
+            sink.format = IMAGE_NONE;
+            sink.logFile = runLog;
+            sink.errors = runErrors;
+            sink.stats = &runStats;
+            sink.canvas = NULL;
+            errNo = executeCommands(program, NULL, &options, &sink);
+        }
+        Program_free(program);
+
+        if (output != NULL && fclose(output) != 0)
+        {
+            errNo = 2; /* Error closing file */
+            printSystemError(runErrors, "ERROR: The output file was not closed "
+                             "successfully");
+        }
+        /* Every message ends with the name of the file it belongs to */
+        if (errNo != 0)
+        {
+            fprintf(runErrors, "ERROR: The input file \"%s\" could not be drawn.\n",
+                    fileName);
+        }
+        else if (ftell(runErrors) > 0)
+        {
+            fprintf(runErrors, "ERROR: The input file \"%s\" was not drawn in "
+                    "full.\n", fileName);
+        }
+
+        pthread_mutex_lock(&batch->lock);
+        if (isDrawn && !appendLog(batch->logFile, runLog))
+        {
+            perror("ERROR: The log could not be written");
+        }
+        if (isDrawn && options.statsFormat != STATS_OFF)
+        {
+            Stats_add(&runStats);
+        }
+        /* Copied the same way as the log, so the messages stay together */
+        appendLog(stderr, runErrors);
+        pthread_mutex_unlock(&batch->lock);
+    }
+
+    if (runLog != NULL)
+    {
+        fclose(runLog);
+    }
+    if (runErrors != NULL)
+    {
+        fclose(runErrors);
+    }
+    free(outputName);
+
+    return errNo;
+}
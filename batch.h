@@ -0,0 +1,8 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "turtleGraphics.h"
+
+int renderBatch(char** fileNames, int numFiles, Options* options);
+
+#endif
@@ -0,0 +1,339 @@
+/**
+ * Benchmark driver for TurtleGraphics. Times each phase of a run in-process,
+ * using the same functions as the TurtleGraphics build, then times whole runs
+ * of each executable given with the output sent to a temporary file. The best
+ * time of all the repeats is reported, along with the bytes written to the
+ * terminal.
+ *
+ * Usage: ./TurtleBench [-r repeats] <fileName> [executable ...]
+ *
+ * The phases are:
+ *  read    - splitting the file into lines, without looking at them
+ *  parse   - validating each line and converting it into a command, which is
+ *            done in the same pass as reading
+ *  execute - executing the commands on the canvas and writing graphics.log
+ *  render  - writing the canvas as terminal escape codes
+ */
+
+/* clock_gettime, fork, exec and friends are POSIX, not C89 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "../boolean.h"
+#include "../fileIO.h"
+#include "../logWriter.h"
+
+#define DEFAULT_REPEATS 3
+
+static double getTime();
+
+static int timePhases(char* fileName, int repeats);
+
+static int timeExecutable(char* executable, char* fileName, int repeats);
+
+static int runProgram(Program* program, double* execute, double* render,
+                      long* numBytes);
+
+static void keepBest(double* best, double time);
+
+/**
+ * Parameters:
+ *  argc - at least two
+ *  argv - executableName, [-r repeats], fileName, [executable ...]
+ * Returns:
+ *  0 on success, or the first error code, please see readCommandsFromFile()
+ *  in fileIO.c for details
+ */
+int main(int argc, char* argv[])
+{
+    int errNo = 0;
+    int repeats = DEFAULT_REPEATS;
+    int first = 1;
+    int ii;
+
+    if (argc >= 3 && strcmp(argv[1], "-r") == 0)
+    {
+        repeats = atoi(argv[2]);
+        first = 3;
+    }
+
+    if (first < argc && repeats >= 1)
+    {
+        printf("%s (best of %d)\n", argv[first], repeats);
+        errNo = timePhases(argv[first], repeats);
+        if (first + 1 < argc)
+        {
+            printf("  %-32s %10s %12s %6s\n", "executable", "seconds", "bytes",
+                   "status");
+        }
+        for (ii = first + 1; ii < argc; ii++)
+        {
+            if (timeExecutable(argv[ii], argv[first], repeats) != 0 && errNo == 0)
+            {
+                errNo = 3; /* System error */
+            }
+        }
+    }
+    else
+    {
+        fprintf(stderr, "Usage: ./TurtleBench [-r repeats] <fileName> "
+                        "[executable ...]\n");
+        errNo = 5;
+    }
+
+    return errNo;
+}
+
+/**
+ * A private function that returns the time in seconds from an arbitrary point,
+ * which is not affected by changes to the system clock.
+ */
+static double getTime()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+/**
+ * A private function that times each phase in-process and prints the best time
+ * of each.
+ *
+ * Returns:
+ *  An error code for a corresponding error, please see readCommandsFromFile()
+ *  in fileIO.c for details
+ */
+static int timePhases(char* fileName, int repeats)
+{
+    int errNo = 0;
+    int length;
+    double start, execute, render;
+    double best[4] = { -1.0, -1.0, -1.0, -1.0 };
+    char* line;
+    long numBytes = 0;
+    int numCommands = 0;
+    LineReader* reader;
+    Program* program;
+
+    while (repeats > 0 && errNo == 0)
+    {
+        start = getTime();
+        reader = LineReader_open(fileName);
+        if (reader != NULL)
+        {
+            while (LineReader_next(reader, &line, &length))
+            {
+                /* Only finding the lines is timed */
+            }
+            LineReader_close(reader);
+            keepBest(&best[0], getTime() - start);
+
+            start = getTime();
+            errNo = readCommandsFromFile(fileName, &program, 0, stderr);
+            keepBest(&best[1], getTime() - start);
+        }
+        else
+        {
+            errNo = 1; /* File could not be opened */
+            perror("ERROR: The file could not be opened");
+        }
+
+        if (errNo == 0)
+        {
+            numCommands = program->size;
+            if (runProgram(program, &execute, &render, &numBytes))
+            {
+                keepBest(&best[2], execute);
+                keepBest(&best[3], render);
+            }
+            else
+            {
+                errNo = 3; /* System error */
+            }
+            Program_free(program);
+        }
+        repeats--;
+    }
+
+    if (errNo == 0)
+    {
+        printf("  %d commands\n", numCommands);
+        printf("  %-8s %10.4f s\n", "read", best[0]);
+        printf("  %-8s %10.4f s\n", "parse", best[1]);
+        printf("  %-8s %10.4f s\n", "execute", best[2]);
+        printf("  %-8s %10.4f s %12ld bytes\n", "render", best[3], numBytes);
+    }
+
+    return errNo;
+}
+
+/**
+ * A private function that executes a Program the same way as executeCommands,
+ * timing the commands and the writing of the canvas separately. The canvas is
+ * written to a temporary file so its size can be measured.
+ *
+ * Parameters:
+ *  program  - the Program to execute
+ *  execute  - (export) the seconds taken by the commands and the log
+ *  render   - (export) the seconds taken to write the canvas
+ *  numBytes - (export) the number of bytes written for the canvas
+ * Returns:
+ *  true(non-zero) on success, false(zero) if something could not be created
+ */
+static int runProgram(Program* program, double* execute, double* render,
+                      long* numBytes)
+{
+    double start;
+    TurtleSettings* settings;
+    Canvas* canvas;
+    LogWriter* log;
+    Geometry* geometry;
+    TileRenderer* renderer;
+    FILE* output;
+    Terminal* terminal;
+    ProgramCounter counter;
+    struct stat info;
+    int isCreated;
+
+    settings = createSettings();
+    canvas = Canvas_create();
+    log = LogWriter_open(FALSE);
+    geometry = Geometry_create();
+    renderer = TileRenderer_create(0);
+    output = tmpfile();
+    terminal = output != NULL ? Terminal_create(output) : NULL;
+    isCreated = settings != NULL && canvas != NULL && log != NULL &&
+                geometry != NULL && renderer != NULL && terminal != NULL;
+    if (isCreated)
+    {
+        Canvas_setPattern(canvas, settings->pattern);
+        start = getTime();
+        ProgramCounter_reset(&counter);
+        counter.numExecuted = NULL;
+        counter.numLeft = -1;
+        executeProgram(settings, canvas, program, &counter, geometry, renderer,
+                       log);
+        LogWriter_close(log);
+        log = NULL;
+        *execute = getTime() - start;
+
+        start = getTime();
+        Canvas_emit(canvas, terminal);
+        Terminal_flush(terminal);
+        *render = getTime() - start;
+        *numBytes = fstat(fileno(output), &info) == 0 ? (long) info.st_size : -1;
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Could not create the drawing.\n");
+    }
+
+    if (log != NULL)
+    {
+        LogWriter_close(log);
+    }
+    if (output != NULL)
+    {
+        fclose(output);
+    }
+    free(settings);
+    free(geometry);
+    TileRenderer_free(renderer);
+    Terminal_free(terminal);
+    Canvas_free(canvas);
+
+    return isCreated;
+}
+
+/**
+ * A private function that keeps the smaller of two times, where a negative best
+ * time means there is none yet.
+ */
+static void keepBest(double* best, double time)
+{
+    if (*best < 0.0 || time < *best)
+    {
+        *best = time;
+    }
+}
+
+/**
+ * A private function that runs an executable on the file several times, with
+ * stdout going to a temporary file and stderr discarded, and prints the best
+ * time, the size of the output and the exit status.
+ *
+ * Returns:
+ *  0 on success, or -1 if the executable could not be run
+ */
+static int timeExecutable(char* executable, char* fileName, int repeats)
+{
+    int result = 0;
+    int status = 0;
+    double start, best = -1.0;
+    FILE* output;
+    int errorFd;
+    struct stat info;
+    pid_t child;
+
+    output = tmpfile();
+    errorFd = open("/dev/null", O_WRONLY);
+    while (repeats > 0 && result == 0 && output != NULL && errorFd >= 0)
+    {
+        if (ftruncate(fileno(output), 0) != 0)
+        {
+            result = -1;
+        }
+        lseek(fileno(output), 0, SEEK_SET);
+
+        start = getTime();
+        child = fork();
+        if (child == 0)
+        {
+            dup2(fileno(output), STDOUT_FILENO);
+            dup2(errorFd, STDERR_FILENO);
+            execl(executable, executable, fileName, (char*) NULL);
+            _exit(127);
+        }
+        else if (child > 0 && waitpid(child, &status, 0) == child)
+        {
+            keepBest(&best, getTime() - start);
+        }
+        else
+        {
+            result = -1;
+        }
+        repeats--;
+    }
+
+    if (result == 0 && output != NULL && errorFd >= 0 &&
+        fstat(fileno(output), &info) == 0)
+    {
+        printf("  %-32s %10.4f %12ld %6d\n", executable, best, (long) info.st_size,
+               WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+    }
+    else
+    {
+        result = -1;
+        perror("ERROR: The executable could not be run");
+    }
+
+    if (output != NULL)
+    {
+        fclose(output);
+    }
+    if (errorFd >= 0)
+    {
+        close(errorFd);
+    }
+
+    return result;
+}
@@ -0,0 +1,591 @@
+/**
+ * Checks that every way TurtleGraphics draws lines covers the same cells. Each
+ * file is drawn with one thread and with several, and through viewports over
+ * parts of the drawing, and each drawing is compared cell by cell with the one
+ * drawn with one thread and no viewport. Random lines are then drawn through
+ * random viewports with Canvas_drawLine() and with the TileRenderer, and
+ * compared with a plain Bresenham rasteriser which steps over every cell of
+ * each line the same way as line() in effects.c. The Arena of each file's
+ * Canvas must also have counted one allocation for each tile drawn on and
+ * every block it used, and keep its blocks when the Canvas is reset.
+ *
+ * Usage: ./TurtleCheck [fileName ...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../boolean.h"
+#include "../fileIO.h"
+#include "../logWriter.h"
+#include "../utils.h"
+
+/* Number of threads drawn with when several are used */
+#define CHECK_THREADS 4
+
+/* Number of viewports each file is drawn through */
+#define NUM_VIEWPORTS 4
+
+/* Viewports over each drawing, in eighths of its width and height from its
+ * top left: left, top, right and bottom. The last two are a single column and
+ * a single row */
+static const int VIEWPORTS[NUM_VIEWPORTS][4] = { { 1, 1, 6, 6 }, { 0, 0, 3, 5 },
+                                                 { 3, 0, 3, 8 }, { 0, 4, 8, 4 } };
+
+/* Number of rounds of random lines, and lines drawn in each */
+#define RANDOM_ROUNDS 20
+#define RANDOM_LINES 200
+
+/* Random lines start and end within this many cells of the origin */
+#define RANDOM_REACH 1000
+
+/* Largest random viewport */
+#define RANDOM_WIDTH 1000
+#define RANDOM_HEIGHT 600
+
+/**
+ * A struct representing the cells a reference drawing covers inside a
+ * viewport, one pattern for each cell, in rows from the top left. A pattern of
+ * '\0' means nothing was drawn in the cell.
+ */
+typedef struct
+{
+    int left;
+    int top;
+    int width;
+    int height;
+    char* patterns;
+} Grid;
+
+static int checkFile(char* fileName);
+
+static Canvas* drawProgram(Program* program, int numThreads, int left, int top,
+                           int right, int bottom);
+
+static int compareCanvases(Canvas* canvas, Canvas* expected, int left, int top,
+                           int right, int bottom);
+
+static int checkArena(Canvas* canvas, int left, int top, int right, int bottom,
+                      long* numTiles, long* numBlocks);
+
+static int checkRandomLines();
+
+static void drawReference(Grid* grid, int x1, int y1, int x2, int y2,
+                          char pattern);
+
+static int compareGrid(Canvas* canvas, Grid* grid);
+
+static int nextRandom(int bound);
+
+/* State of the random number generator, a linear congruential generator so
+ * the lines do not depend on the C library */
+static unsigned long randomState = 1;
+
+/**
+ * Parameters:
+ *  argc - at least one
+ *  argv - executableName, [fileName ...]
+ * Returns:
+ *  0 if every drawing matched, 1 if one did not or something could not be
+ *  created, or the error code of a file which could not be read, please see
+ *  readCommandsFromFile() in fileIO.c for details
+ */
+int main(int argc, char* argv[])
+{
+    int errNo = 0;
+    int result;
+    int ii;
+
+    for (ii = 1; ii < argc; ii++)
+    {
+        result = checkFile(argv[ii]);
+        if (result != 0 && errNo == 0)
+        {
+            errNo = result;
+        }
+    }
+
+    if (!checkRandomLines() && errNo == 0)
+    {
+        errNo = 1;
+    }
+
+    printf("%s\n", errNo == 0 ? "All checks passed." : "CHECKS FAILED.");
+
+    return errNo;
+}
+
+/**
+ * A private function that draws a file with one thread and with several, and
+ * through each of the viewports with both, and compares every drawing with the
+ * first one, whose Arena is then checked.
+ *
+ * Returns:
+ *  0 if every drawing matched, 1 if one did not or could not be drawn, or the
+ *  error code of reading the file
+ */
+static int checkFile(char* fileName)
+{
+    int errNo;
+    Program* program;
+    Canvas* expected;
+    Canvas* canvas;
+    int left, top, right, bottom, width, height;
+    int viewLeft, viewTop, viewRight, viewBottom;
+    int numThreads, ii;
+    long numTiles, numBlocks;
+
+    errNo = readCommandsFromFile(fileName, &program, 1, stderr);
+    if (errNo == 0)
+    {
+        expected = drawProgram(program, 1, 0, 0, MAX_CANVAS_SIZE - 1,
+                               MAX_CANVAS_SIZE - 1);
+        if (expected == NULL || !Canvas_getBounds(expected, &left, &top, &right,
+                                                  &bottom))
+        {
+            errNo = 1;
+            fprintf(stderr, "ERROR: %s could not be drawn.\n", fileName);
+        }
+        else
+        {
+            width = right - left + 1;
+            height = bottom - top + 1;
+        }
+
+        /* With several threads and no viewport first, then each viewport */
+        for (ii = -1; ii < NUM_VIEWPORTS && errNo == 0; ii++)
+        {
+            viewLeft = ii < 0 ? 0 : left + width * VIEWPORTS[ii][0] / 8;
+            viewTop = ii < 0 ? 0 : top + height * VIEWPORTS[ii][1] / 8;
+            viewRight = ii < 0 ? MAX_CANVAS_SIZE - 1 :
+                                 left + width * VIEWPORTS[ii][2] / 8;
+            viewBottom = ii < 0 ? MAX_CANVAS_SIZE - 1 :
+                                  top + height * VIEWPORTS[ii][3] / 8;
+            for (numThreads = ii < 0 ? CHECK_THREADS : 1;
+                 numThreads <= CHECK_THREADS && errNo == 0;
+                 numThreads += CHECK_THREADS - 1)
+            {
+                canvas = drawProgram(program, numThreads, viewLeft, viewTop,
+                                     viewRight, viewBottom);
+                if (canvas == NULL ||
+                    !compareCanvases(canvas, expected, viewLeft, viewTop,
+                                     viewRight, viewBottom))
+                {
+                    errNo = 1;
+                    fprintf(stderr, "ERROR: %s differs when drawn with %d "
+                            "threads through the viewport from (%d, %d) to "
+                            "(%d, %d).\n", fileName, numThreads, viewLeft,
+                            viewTop, viewRight, viewBottom);
+                }
+                Canvas_free(canvas);
+            }
+        }
+        if (errNo == 0 && !checkArena(expected, left, top, right, bottom,
+                                      &numTiles, &numBlocks))
+        {
+            errNo = 1;
+            fprintf(stderr, "ERROR: The arena of %s was not counted right.\n",
+                    fileName);
+        }
+        Canvas_free(expected);
+        Program_free(program);
+    }
+
+    if (errNo == 0)
+    {
+        printf("%s: the same with %d threads and through %d viewports, with %ld "
+               "allocations in %ld arena blocks\n", fileName, CHECK_THREADS,
+               NUM_VIEWPORTS, numTiles, numBlocks);
+    }
+
+    return errNo;
+}
+
+/**
+ * A private function that executes a Program the same way as executeCommands,
+ * on a Canvas with a viewport, without writing graphics.log.
+ *
+ * Parameters:
+ *  program    - the Program to execute
+ *  numThreads - the number of threads to draw with
+ *  left       - the first column of the viewport
+ *  top        - the first row of the viewport
+ *  right      - the last column of the viewport
+ *  bottom     - the last row of the viewport
+ * Returns:
+ *  canvas - the Canvas drawn on, or NULL if something could not be created
+ */
+static Canvas* drawProgram(Program* program, int numThreads, int left, int top,
+                           int right, int bottom)
+{
+    TurtleSettings* settings;
+    Canvas* canvas;
+    FILE* logFile;
+    LogWriter* log;
+    Geometry* geometry;
+    TileRenderer* renderer;
+    ProgramCounter counter;
+
+    settings = createSettings();
+    canvas = Canvas_create();
+    logFile = tmpfile();
+    log = logFile != NULL ? LogWriter_openStream(logFile, FALSE) : NULL;
+    geometry = Geometry_create();
+    renderer = TileRenderer_create(numThreads);
+    if (settings != NULL && canvas != NULL && log != NULL && geometry != NULL &&
+        renderer != NULL)
+    {
+        Canvas_setPattern(canvas, settings->pattern);
+        Canvas_setViewport(canvas, left, top, right, bottom);
+        ProgramCounter_reset(&counter);
+        counter.numExecuted = NULL;
+        counter.numLeft = -1;
+        executeProgram(settings, canvas, program, &counter, geometry, renderer,
+                       log);
+    }
+    else
+    {
+        Canvas_free(canvas);
+        canvas = NULL;
+    }
+
+    if (log != NULL)
+    {
+        LogWriter_close(log);
+    }
+    if (logFile != NULL)
+    {
+        fclose(logFile);
+    }
+    free(settings);
+    free(geometry);
+    TileRenderer_free(renderer);
+
+    return canvas;
+}
+
+/**
+ * A private function that compares the cells of two canvases over a rectangle,
+ * and prints the first cell which differs.
+ *
+ * Returns:
+ *  true(non-zero) if every cell is the same, false(zero) otherwise
+ */
+static int compareCanvases(Canvas* canvas, Canvas* expected, int left, int top,
+                           int right, int bottom)
+{
+    Cell* row;
+    Cell* expectedRow;
+    int width, x, y;
+    int isSame = TRUE;
+
+    width = right - left + 1;
+    row = (Cell*) malloc(sizeof(Cell) * width);
+    expectedRow = (Cell*) malloc(sizeof(Cell) * width);
+    isSame = row != NULL && expectedRow != NULL;
+    for (y = top; y <= bottom && isSame; y++)
+    {
+        Canvas_copyRow(canvas, y, left, width, row);
+        Canvas_copyRow(expected, y, left, width, expectedRow);
+        for (x = 0; x < width && isSame; x++)
+        {
+            if (row[x].pattern != expectedRow[x].pattern ||
+                row[x].fgColour != expectedRow[x].fgColour ||
+                row[x].bgColour != expectedRow[x].bgColour)
+            {
+                isSame = FALSE;
+                fprintf(stderr, "ERROR: The cell at (%d, %d) is '%c' instead of "
+                        "'%c'.\n", left + x, y, row[x].pattern ? row[x].pattern : ' ',
+                        expectedRow[x].pattern ? expectedRow[x].pattern : ' ');
+            }
+        }
+    }
+    free(row);
+    free(expectedRow);
+
+    return isSame;
+}
+
+/**
+ * A private function that checks the counters of a Canvas's Arena after a
+ * drawing. Each tile with a cell drawn inside the rectangle must be one
+ * allocation, the number of blocks must be the length of the Arena's list of
+ * blocks, and every block but the current one must be too full for another
+ * tile. Resetting the Canvas must then zero both counters and keep every block
+ * as a spare.
+ *
+ * Parameters:
+ *  canvas    - the Canvas to check, which is reset
+ *  left      - the first column drawn on
+ *  top       - the first row drawn on
+ *  right     - the last column drawn on
+ *  bottom    - the last row drawn on
+ *  numTiles  - (export) the number of tiles drawn on
+ *  numBlocks - (export) the number of blocks in the Arena
+ * Returns:
+ *  true(non-zero) if every count is right, false(zero) otherwise
+ */
+static int checkArena(Canvas* canvas, int left, int top, int right, int bottom,
+                      long* numTiles, long* numBlocks)
+{
+    Arena* arena = canvas->arena;
+    ArenaBlock* block;
+    Cell* row;
+    char* isDrawn;
+    int width, firstColumn, numColumns, tileBottom, column, x, y;
+    long numSpare = 0;
+    int isRight;
+
+    /* Mark the columns of tiles with a drawn cell, a row of tiles at a time */
+    width = right - left + 1;
+    firstColumn = floorDivide(left, CANVAS_TILE_SIZE);
+    numColumns = floorDivide(right, CANVAS_TILE_SIZE) - firstColumn + 1;
+    row = (Cell*) malloc(sizeof(Cell) * width);
+    isDrawn = (char*) malloc(numColumns);
+    isRight = row != NULL && isDrawn != NULL;
+    *numTiles = 0;
+    y = top;
+    while (y <= bottom && isRight)
+    {
+        memset(isDrawn, FALSE, numColumns);
+        tileBottom = floorDivide(y, CANVAS_TILE_SIZE) * CANVAS_TILE_SIZE +
+                     CANVAS_TILE_SIZE - 1;
+        while (y <= bottom && y <= tileBottom)
+        {
+            Canvas_copyRow(canvas, y, left, width, row);
+            for (x = 0; x < width; x++)
+            {
+                if (row[x].pattern != '\0')
+                {
+                    isDrawn[floorDivide(left + x, CANVAS_TILE_SIZE) - firstColumn] =
+                        TRUE;
+                }
+            }
+            y++;
+        }
+        for (column = 0; column < numColumns; column++)
+        {
+            *numTiles += isDrawn[column];
+        }
+    }
+    free(row);
+    free(isDrawn);
+
+    *numBlocks = 0;
+    for (block = arena->head; block != NULL; block = block->next)
+    {
+        (*numBlocks)++;
+        if (block != arena->head && block->size - block->used >= sizeof(CanvasTile))
+        {
+            isRight = FALSE;
+            fprintf(stderr, "ERROR: A block of the arena has room for another "
+                    "tile.\n");
+        }
+    }
+    if (arena->numAllocations != *numTiles || arena->numBlocks != *numBlocks)
+    {
+        isRight = FALSE;
+        fprintf(stderr, "ERROR: The arena counted %ld allocations in %ld blocks "
+                "instead of %ld in %ld.\n", arena->numAllocations,
+                arena->numBlocks, *numTiles, *numBlocks);
+    }
+
+    Canvas_reset(canvas);
+    for (block = arena->spare; block != NULL; block = block->next)
+    {
+        numSpare++;
+    }
+    if (arena->numAllocations != 0 || arena->numBlocks != 0 ||
+        numSpare != *numBlocks)
+    {
+        isRight = FALSE;
+        fprintf(stderr, "ERROR: Resetting the canvas kept %ld of its %ld blocks "
+                "and counted %ld allocations in %ld blocks.\n", numSpare,
+                *numBlocks, arena->numAllocations, arena->numBlocks);
+    }
+
+    return isRight;
+}
+
+/**
+ * A private function that draws rounds of random lines, each line with a
+ * pattern of its own, through a random viewport with Canvas_drawLine() and
+ * with the TileRenderer, and compares both with the reference rasteriser.
+ *
+ * Returns:
+ *  true(non-zero) if every round matched, false(zero) otherwise
+ */
+static int checkRandomLines()
+{
+    int lines[RANDOM_LINES][4];
+    Grid grid;
+    Canvas* direct;
+    Canvas* rendered;
+    TileRenderer* renderer;
+    int round, ii, jj;
+    char pattern;
+    int isSame = TRUE;
+
+    grid.patterns = (char*) malloc(RANDOM_WIDTH * RANDOM_HEIGHT);
+    renderer = TileRenderer_create(CHECK_THREADS);
+    for (round = 0; round < RANDOM_ROUNDS && isSame; round++)
+    {
+        grid.left = nextRandom(2 * RANDOM_REACH) - RANDOM_REACH;
+        grid.top = nextRandom(2 * RANDOM_REACH) - RANDOM_REACH;
+        grid.width = 1 + nextRandom(RANDOM_WIDTH);
+        grid.height = 1 + nextRandom(RANDOM_HEIGHT);
+        for (ii = 0; ii < RANDOM_LINES; ii++)
+        {
+            /* Half of the lines start inside the viewport */
+            for (jj = 0; jj < 4; jj++)
+            {
+                lines[ii][jj] = nextRandom(2 * RANDOM_REACH) - RANDOM_REACH;
+            }
+            if (ii % 2 == 0)
+            {
+                lines[ii][0] = grid.left + nextRandom(grid.width);
+                lines[ii][1] = grid.top + nextRandom(grid.height);
+            }
+        }
+
+        direct = Canvas_create();
+        rendered = Canvas_create();
+        isSame = grid.patterns != NULL && renderer != NULL && direct != NULL &&
+                 rendered != NULL;
+        if (isSame)
+        {
+            memset(grid.patterns, '\0', RANDOM_WIDTH * RANDOM_HEIGHT);
+            Canvas_setViewport(direct, grid.left, grid.top,
+                               grid.left + grid.width - 1, grid.top + grid.height - 1);
+            Canvas_setViewport(rendered, grid.left, grid.top,
+                               grid.left + grid.width - 1, grid.top + grid.height - 1);
+            for (ii = 0; ii < RANDOM_LINES; ii++)
+            {
+                pattern = (char) ('a' + ii % 26);
+                drawReference(&grid, lines[ii][0], lines[ii][1], lines[ii][2],
+                              lines[ii][3], pattern);
+                Canvas_setPattern(direct, pattern);
+                Canvas_drawLine(direct, lines[ii][0], lines[ii][1], lines[ii][2],
+                                lines[ii][3]);
+                Canvas_setPattern(rendered, pattern);
+                TileRenderer_add(renderer, rendered, lines[ii][0], lines[ii][1],
+                                 lines[ii][2], lines[ii][3]);
+            }
+            TileRenderer_flush(renderer, rendered);
+            isSame = compareGrid(direct, &grid) && compareGrid(rendered, &grid);
+            if (!isSame)
+            {
+                fprintf(stderr, "ERROR: Random lines differ in round %d, through "
+                        "the viewport from (%d, %d) to (%d, %d).\n", round,
+                        grid.left, grid.top, grid.left + grid.width - 1,
+                        grid.top + grid.height - 1);
+            }
+        }
+        Canvas_free(direct);
+        Canvas_free(rendered);
+    }
+    free(grid.patterns);
+    TileRenderer_free(renderer);
+
+    if (isSame)
+    {
+        printf("Random lines: the same as the reference in %d rounds of %d\n",
+               RANDOM_ROUNDS, RANDOM_LINES);
+    }
+
+    return isSame;
+}
+
+/**
+ * A private function that draws a line on a Grid with Bresenham's algorithm,
+ * stepping over every cell of the line from (x1, y1) to (x2, y2) the same way
+ * as line() in effects.c and keeping those inside the Grid.
+ */
+static void drawReference(Grid* grid, int x1, int y1, int x2, int y2,
+                          char pattern)
+{
+    int x = x1, y = y1;
+    int majorDelta, minorDelta, decision, ii;
+    int majorX, majorY, minorX, minorY;
+
+    majorDelta = abs(x2 - x1);
+    minorDelta = abs(y2 - y1);
+    majorX = x2 < x1 ? -1 : 1;
+    majorY = 0;
+    minorX = 0;
+    minorY = y2 < y1 ? -1 : 1;
+    if (minorDelta > majorDelta)
+    {
+        ii = majorDelta;
+        majorDelta = minorDelta;
+        minorDelta = ii;
+        majorY = minorY;
+        minorX = majorX;
+        majorX = 0;
+        minorY = 0;
+    }
+
+    decision = majorDelta / 2;
+    for (ii = 0; ii <= majorDelta; ii++)
+    {
+        if (x >= grid->left && x < grid->left + grid->width &&
+            y >= grid->top && y < grid->top + grid->height)
+        {
+            grid->patterns[(y - grid->top) * grid->width + (x - grid->left)] =
+                pattern;
+        }
+
+        x += majorX;
+        y += majorY;
+        decision += minorDelta;
+        if (decision >= majorDelta)
+        {
+            decision -= majorDelta;
+            x += minorX;
+            y += minorY;
+        }
+    }
+}
+
+/**
+ * A private function that compares the patterns of a canvas with a Grid over
+ * the Grid's viewport, and prints the first cell which differs.
+ *
+ * Returns:
+ *  true(non-zero) if every cell is the same, false(zero) otherwise
+ */
+static int compareGrid(Canvas* canvas, Grid* grid)
+{
+    Cell row[RANDOM_WIDTH];
+    char expected;
+    int x, y;
+    int isSame = TRUE;
+
+    for (y = 0; y < grid->height && isSame; y++)
+    {
+        Canvas_copyRow(canvas, grid->top + y, grid->left, grid->width, row);
+        for (x = 0; x < grid->width && isSame; x++)
+        {
+            expected = grid->patterns[y * grid->width + x];
+            if (row[x].pattern != expected)
+            {
+                isSame = FALSE;
+                fprintf(stderr, "ERROR: The cell at (%d, %d) is '%c' instead of "
+                        "'%c'.\n", grid->left + x, grid->top + y,
+                        row[x].pattern ? row[x].pattern : ' ',
+                        expected ? expected : ' ');
+            }
+        }
+    }
+
+    return isSame;
+}
+
+/**
+ * Returns a pseudo-random number from 0 to bound - 1.
+ */
+static int nextRandom(int bound)
+{
+    randomState = (randomState * 1103515245UL + 12345UL) & 0x7fffffffUL;
+    return (int) ((randomState >> 16) % (unsigned long) bound);
+}
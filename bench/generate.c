@@ -0,0 +1,286 @@
+/**
+ * Generates synthetic command files for benchmarking TurtleGraphics. Every
+ * shape keeps the cursor inside a fixed area, so the whole file is executed
+ * however many commands are asked for, and the same seed always gives the same
+ * file.
+ *
+ * Usage: ./TurtleGenerate <shape> <numCommands> [seed]
+ *
+ *  spiral - rings of DRAW and ROTATE 15 growing from one point, with a colour
+ *           change every ring
+ *  walk   - a random walk of DRAW and MOVE along the four directions, with the
+ *           occasional FG and PATTERN
+ *  pixel  - dense DRAW 1 pixel art, row by row with frequent FG and PATTERN
+ *           changes, like testfiles/input2.txt
+ *  sparse - long MOVEs across a large area with few DRAWs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../boolean.h"
+
+/* Number of sides of each ring of the spiral, 360 / 15 degrees */
+#define SPIRAL_SIDES 24
+
+/* Number of different ring sizes of the spiral */
+#define SPIRAL_RINGS 20
+
+/* Size of the pixel art drawing, with an even number of rows */
+#define PIXEL_WIDTH 120
+#define PIXEL_HEIGHT 40
+
+static const char PATTERNS[] = "+*#@.-=o";
+
+static void generateSpiral(long numCommands);
+
+static void generateWalk(long numCommands, int width, int height, int maxDistance,
+                         int movePercent);
+
+static void generatePixel(long numCommands);
+
+static int emit(long* numLeft, const char* format, int value);
+
+static int nextRandom(int bound);
+
+/* State of the random number generator, a linear congruential generator so
+ * the output does not depend on the C library */
+static unsigned long randomState = 1;
+
+/**
+ * Parameters:
+ *  argc - three or four
+ *  argv - executableName, shape, numCommands, [seed]
+ * Returns:
+ *  0 on success, or 1 for invalid arguments
+ */
+int main(int argc, char* argv[])
+{
+    int errNo = 0;
+    long numCommands = 0;
+    char* end;
+
+    if (argc == 3 || argc == 4)
+    {
+        numCommands = strtol(argv[2], &end, 10);
+        if (*end != '\0' || numCommands < 1)
+        {
+            errNo = 1;
+        }
+        if (argc == 4)
+        {
+            randomState = strtoul(argv[3], &end, 10);
+        }
+    }
+    else
+    {
+        errNo = 1;
+    }
+
+    if (errNo == 0)
+    {
+        if (strcmp(argv[1], "spiral") == 0)
+        {
+            generateSpiral(numCommands);
+        }
+        else if (strcmp(argv[1], "walk") == 0)
+        {
+            generateWalk(numCommands, 160, 50, 8, 20);
+        }
+        else if (strcmp(argv[1], "pixel") == 0)
+        {
+            generatePixel(numCommands);
+        }
+        else if (strcmp(argv[1], "sparse") == 0)
+        {
+            generateWalk(numCommands, 2000, 500, 200, 95);
+        }
+        else
+        {
+            errNo = 1;
+        }
+    }
+
+    if (errNo != 0)
+    {
+        fprintf(stderr, "Usage: ./TurtleGenerate <spiral|walk|pixel|sparse> "
+                        "<numCommands> [seed]\n");
+    }
+
+    return errNo;
+}
+
+/**
+ * Prints rings which all start from the same point. Each ring has SPIRAL_SIDES
+ * equal sides and ends where it started, so the size of the sides can change
+ * between rings.
+ */
+static void generateSpiral(long numCommands)
+{
+    long ring = 0;
+    int side;
+    int isRunning;
+
+    /* Move to the bottom of the rings, which curve upwards as ROTATE turns
+     * anticlockwise. The largest ring is about 155 cells across */
+    isRunning = emit(&numCommands, "ROTATE %d", -90) &&
+                emit(&numCommands, "MOVE %d", 160) &&
+                emit(&numCommands, "ROTATE %d", 90) &&
+                emit(&numCommands, "MOVE %d", 100);
+    while (isRunning)
+    {
+        isRunning = emit(&numCommands, "FG %d", (int) (ring % 15) + 1);
+        for (side = 0; side < SPIRAL_SIDES && isRunning; side++)
+        {
+            isRunning = emit(&numCommands, "DRAW %d", (int) (ring % SPIRAL_RINGS) + 1) &&
+                        emit(&numCommands, "ROTATE %d", 360 / SPIRAL_SIDES);
+        }
+        ring++;
+    }
+}
+
+/**
+ * Prints a random walk along the four directions which stays inside a box with
+ * its top-left corner at the origin.
+ *
+ * Parameters:
+ *  width       - the width of the box
+ *  height      - the height of the box
+ *  maxDistance - the longest step
+ *  movePercent - the percentage of steps which are MOVE instead of DRAW
+ */
+static void generateWalk(long numCommands, int width, int height, int maxDistance,
+                         int movePercent)
+{
+    /* Steps in x and y for each direction, with y increasing downwards */
+    static const int STEP_X[4] = { 1, 0, -1, 0 };
+    static const int STEP_Y[4] = { 0, -1, 0, 1 };
+    int x = 0, y = 0, direction = 0;
+    int turn, distance, room;
+    int isRunning = TRUE;
+
+    while (isRunning)
+    {
+        if (nextRandom(100) < 10)
+        {
+            if (nextRandom(2) == 0)
+            {
+                isRunning = emit(&numCommands, "FG %d", nextRandom(16));
+            }
+            else
+            {
+                isRunning = emit(&numCommands, "PATTERN %c",
+                                 PATTERNS[nextRandom(sizeof(PATTERNS) - 1)]);
+            }
+        }
+        else
+        {
+            turn = nextRandom(4);
+            if (turn != 0)
+            {
+                direction = (direction + turn) % 4;
+                isRunning = emit(&numCommands, "ROTATE %d", turn * 90);
+            }
+
+            /* Distance to the edge of the box in the new direction */
+            room = STEP_X[direction] > 0 ? width - 1 - x :
+                   STEP_X[direction] < 0 ? x :
+                   STEP_Y[direction] > 0 ? height - 1 - y : y;
+            distance = 1 + nextRandom(maxDistance);
+            if (distance > room)
+            {
+                distance = room;
+            }
+
+            if (distance > 0 && isRunning)
+            {
+                x += STEP_X[direction] * distance;
+                y += STEP_Y[direction] * distance;
+                isRunning = emit(&numCommands, nextRandom(100) < movePercent ?
+                                 "MOVE %d" : "DRAW %d", distance);
+            }
+        }
+    }
+}
+
+/**
+ * Prints pixel art one cell at a time, going back and forth across the rows
+ * and starting again from the top once the bottom is reached.
+ */
+static void generatePixel(long numCommands)
+{
+    int x, row;
+    int isRunning = TRUE;
+
+    isRunning = emit(&numCommands, "BG %d", 0);
+    while (isRunning)
+    {
+        for (row = 0; row < PIXEL_HEIGHT && isRunning; row++)
+        {
+            for (x = 0; x < PIXEL_WIDTH - 1 && isRunning; x++)
+            {
+                if (nextRandom(100) < 30)
+                {
+                    isRunning = emit(&numCommands, "FG %d", nextRandom(16));
+                }
+                if (nextRandom(100) < 30 && isRunning)
+                {
+                    isRunning = emit(&numCommands, "PATTERN %c",
+                                     PATTERNS[nextRandom(sizeof(PATTERNS) - 1)]);
+                }
+                if (isRunning)
+                {
+                    isRunning = emit(&numCommands, "DRAW %d", 1);
+                }
+            }
+
+            /* Turn down one row and face back the other way */
+            if (row < PIXEL_HEIGHT - 1 && isRunning)
+            {
+                isRunning = emit(&numCommands, "ROTATE %d", row % 2 == 0 ? -90 : 90) &&
+                            emit(&numCommands, "MOVE %d", 1) &&
+                            emit(&numCommands, "ROTATE %d", row % 2 == 0 ? -90 : 90);
+            }
+        }
+
+        /* The last row ends on the left facing left as PIXEL_HEIGHT is even,
+         * so turn up to the top-left corner and face right again */
+        if (isRunning)
+        {
+            isRunning = emit(&numCommands, "ROTATE %d", -90) &&
+                        emit(&numCommands, "MOVE %d", PIXEL_HEIGHT - 1) &&
+                        emit(&numCommands, "ROTATE %d", -90);
+        }
+    }
+}
+
+/**
+ * Prints one command if there are any left to print.
+ *
+ * Parameters:
+ *  numLeft - (export) the number of commands left to print
+ *  format  - the printf format of the command
+ *  value   - the value of the command
+ * Returns:
+ *  true(non-zero) if more commands can be printed, false(zero) otherwise
+ */
+static int emit(long* numLeft, const char* format, int value)
+{
+    if (*numLeft > 0)
+    {
+        printf(format, value);
+        putchar('\n');
+        (*numLeft)--;
+    }
+
+    return *numLeft > 0;
+}
+
+/**
+ * Returns a pseudo-random number from 0 to bound - 1.
+ */
+static int nextRandom(int bound)
+{
+    randomState = (randomState * 1103515245UL + 12345UL) & 0x7fffffffUL;
+    return (int) ((randomState >> 16) % (unsigned long) bound);
+}
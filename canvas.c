@@ -0,0 +1,897 @@
+/**
+ * Implementation of an off-screen character canvas. Every cell that a line
+ * passes over is stored in memory along with its colours, and the whole canvas
+ * is written out in a single pass, row by row, once drawing has finished. This
+ * means each run of adjacent cells only needs one cursor movement instead of
+ * one per character, and the Terminal keeps even those short.
+ *
+ * The cells are kept in square tiles which are only allocated when something
+ * is drawn in them, found through an open addressing hash table keyed by the
+ * tile's top left cell. The tile plotted last is remembered, so a line only
+ * looks a tile up when it crosses into the next one. Rows and columns can be
+ * negative or very large, and the memory used follows the area drawn rather
+ * than the size of the drawing.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "boolean.h"
+#include "canvas.h"
+#include "utils.h"
+#include "stats.h"
+
+/* Number of bytes in each block of the canvas's Arena */
+#define ARENA_BLOCK_SIZE 65536
+
+/* Number of slots in the hash table of a new canvas, a power of two */
+#define INITIAL_TABLE_SIZE 64
+
+static void Canvas_plotCell(Canvas* canvas, int x, int y);
+
+static void Canvas_plotLineCell(int x, int y, void* canvas);
+
+static void Canvas_plotSpan(Canvas* canvas, int y, int left, int right);
+
+static int clipAxis(int start, int end, int low, int high, int* first, int* last);
+
+static void getStep(ClippedLine* clip, int isXLonger, int x1, int y1, int step,
+                    int* x, int* y, int* decision);
+
+static int getTileOrigin(int n);
+
+static CanvasTile** findSlot(Canvas* canvas, int left, int top);
+
+static int growTable(Canvas* canvas);
+
+static int compareTiles(const void* first, const void* second);
+
+/**
+ * Allocates enough memory for an empty Canvas and initialises all fields to
+ * their default values and returns the Canvas. The viewport starts as the
+ * first MAX_CANVAS_SIZE rows and columns from the top left of the terminal.
+ *
+ * Returns:
+ *  canvas - an empty Canvas, or NULL if the memory could not be allocated
+ */
+Canvas* Canvas_create()
+{
+    Canvas* canvas = (Canvas*) malloc(sizeof(Canvas));
+
+    if (canvas != NULL)
+    {
+        canvas->arena = Arena_create(ARENA_BLOCK_SIZE);
+        canvas->table = (CanvasTile**) calloc(INITIAL_TABLE_SIZE, sizeof(CanvasTile*));
+        if (canvas->arena == NULL || canvas->table == NULL)
+        {
+            Arena_free(canvas->arena);
+            free(canvas->table);
+            free(canvas);
+            canvas = NULL;
+        }
+    }
+    if (canvas != NULL)
+    {
+        canvas->tableSize = INITIAL_TABLE_SIZE;
+        canvas->numTiles = 0;
+        canvas->dirtyTiles = NULL;
+        canvas->numDirty = 0;
+        canvas->dirtyCapacity = 0;
+        canvas->lastTile = NULL;
+        Canvas_setViewport(canvas, 0, 0, MAX_CANVAS_SIZE - 1, MAX_CANVAS_SIZE - 1);
+        canvas->pen.pattern = '+';
+        canvas->pen.fgColour = DEFAULT_COLOUR;
+        canvas->pen.bgColour = DEFAULT_COLOUR;
+    }
+
+    return canvas;
+}
+
+/**
+ * Empties a Canvas so it can be drawn on again as if it had just been created,
+ * keeping the memory it has grown to so the next drawing can use it without
+ * allocating. The viewport and pen go back to those of a new Canvas.
+ *
+ * Parameters:
+ *  canvas - the Canvas to empty
+ */
+void Canvas_reset(Canvas* canvas)
+{
+    Arena_reset(canvas->arena);
+    memset(canvas->table, 0, canvas->tableSize * sizeof(CanvasTile*));
+    canvas->numTiles = 0;
+    canvas->numDirty = 0;
+    canvas->lastTile = NULL;
+    Canvas_setViewport(canvas, 0, 0, MAX_CANVAS_SIZE - 1, MAX_CANVAS_SIZE - 1);
+    canvas->pen.pattern = '+';
+    canvas->pen.fgColour = DEFAULT_COLOUR;
+    canvas->pen.bgColour = DEFAULT_COLOUR;
+}
+
+/**
+ * Sets the part of the canvas which is kept, from the top left cell to the
+ * bottom right cell inclusive. Cells plotted outside it are ignored, and the
+ * top left cell is the one written to the top left of the terminal. It should
+ * be set before anything is drawn.
+ *
+ * Parameters:
+ *  canvas - the Canvas to set the viewport of
+ *  left   - the first column kept
+ *  top    - the first row kept
+ *  right  - the last column kept
+ *  bottom - the last row kept
+ */
+void Canvas_setViewport(Canvas* canvas, int left, int top, int right, int bottom)
+{
+    canvas->left = left;
+    canvas->top = top;
+    canvas->right = right;
+    canvas->bottom = bottom;
+}
+
+/**
+ * Sets the character that the next cells will be drawn with.
+ */
+void Canvas_setPattern(Canvas* canvas, char pattern)
+{
+    canvas->pen.pattern = pattern;
+}
+
+/**
+ * Sets the foreground colour (0-15) that the next cells will be drawn with.
+ */
+void Canvas_setFgColour(Canvas* canvas, int code)
+{
+    canvas->pen.fgColour = (signed char) code;
+}
+
+/**
+ * Sets the background colour (0-7) that the next cells will be drawn with.
+ */
+void Canvas_setBgColour(Canvas* canvas, int code)
+{
+    canvas->pen.bgColour = (signed char) code;
+}
+
+/**
+ * Draws a line with the current pen, covering exactly the same cells as line()
+ * in effects.c: Bresenham's algorithm steps once along the longer axis for each
+ * cell, starting with the decision at half the longer distance, and steps
+ * across once the decision reaches it. Cells outside the viewport are ignored.
+ * The line is first clipped to the viewport, so only the cells inside it are
+ * stepped over however long the line is. Horizontal lines are filled as one
+ * span of the row, and the rest are stepped over by Canvas_stepLine().
+ *
+ * Parameters:
+ *  canvas - the Canvas to draw on
+ *  x1     - the column the line starts from
+ *  y1     - the row the line starts from
+ *  x2     - the column the line ends at
+ *  y2     - the row the line ends at
+ */
+void Canvas_drawLine(Canvas* canvas, int x1, int y1, int x2, int y2)
+{
+    ClippedLine clip;
+
+    if (!Canvas_clipLine(x1, y1, x2, y2, canvas->left, canvas->top,
+                         canvas->right, canvas->bottom, &clip))
+    {
+        /* Nothing to draw */
+    }
+    else if (clip.dy == 0)
+    {
+        Canvas_plotSpan(canvas, clip.y, clip.x < clip.endX ? clip.x : clip.endX,
+                        clip.x < clip.endX ? clip.endX : clip.x);
+    }
+    else
+    {
+        Canvas_stepLine(&clip, &Canvas_plotLineCell, canvas);
+    }
+}
+
+/**
+ * Plots each cell of the part of a line inside a rectangle, as clipped by
+ * Canvas_clipLine(), in the order Bresenham's algorithm reaches them. Vertical
+ * and diagonal lines step straight from cell to cell, and the rest step with
+ * the decision, with the steps fixed for the line's octant.
+ *
+ * Parameters:
+ *  clip     - the part of the line to plot
+ *  plotter  - the function to plot each cell with
+ *  plotData - the data given to the plotter with each cell
+ */
+void Canvas_stepLine(ClippedLine* clip, CellPlotFunc plotter, void* plotData)
+{
+    int x, y, decision, ii;
+
+    x = clip->x;
+    y = clip->y;
+    decision = clip->decision;
+    if (clip->dx == 0 || clip->dx == clip->dy)
+    {
+        /* Bresenham steps across on every step along these, if at all */
+        for (ii = clip->first; ii <= clip->last; ii++)
+        {
+            (*plotter)(x, y, plotData);
+            x += clip->dx == 0 ? 0 : clip->stepX;
+            y += clip->stepY;
+        }
+    }
+    else if (clip->dx > clip->dy)
+    {
+        for (ii = clip->first; ii <= clip->last; ii++)
+        {
+            (*plotter)(x, y, plotData);
+            x += clip->stepX;
+            decision += clip->dy;
+            if (decision >= clip->dx)
+            {
+                decision -= clip->dx;
+                y += clip->stepY;
+            }
+        }
+    }
+    else
+    {
+        for (ii = clip->first; ii <= clip->last; ii++)
+        {
+            (*plotter)(x, y, plotData);
+            y += clip->stepY;
+            decision += clip->dx;
+            if (decision >= clip->dy)
+            {
+                decision -= clip->dy;
+                x += clip->stepX;
+            }
+        }
+    }
+}
+
+/**
+ * Clips a line to a rectangle, finding the steps of Bresenham's algorithm whose
+ * cells are inside it. After 'step' steps along the longer axis the line has
+ * moved (longer / 2 + step * shorter) / longer cells along the shorter one, so
+ * the first and last steps inside come straight from the rectangle's edges,
+ * along with the decision at the first step. Drawing just those steps gives
+ * exactly the cells of the whole line which are inside the rectangle.
+ *
+ * Parameters:
+ *  x1     - the column the line starts from
+ *  y1     - the row the line starts from
+ *  x2     - the column the line ends at
+ *  y2     - the row the line ends at
+ *  left   - the first column of the rectangle
+ *  top    - the first row of the rectangle
+ *  right  - the last column of the rectangle
+ *  bottom - the last row of the rectangle
+ *  clip   - (export) the part of the line inside the rectangle
+ * Returns:
+ *  true(non-zero) if any of the line is inside, false(zero) otherwise
+ */
+int Canvas_clipLine(int x1, int y1, int x2, int y2, int left, int top,
+                    int right, int bottom, ClippedLine* clip)
+{
+    int longer, shorter, first, last, lowest, highest, decision;
+    int isXLonger, isInside;
+    long sum;
+
+    clip->dx = x2 - x1;
+    clip->stepX = 1;
+    if (clip->dx < 0)
+    {
+        clip->dx = -(clip->dx);
+        clip->stepX = -1;
+    }
+    clip->dy = y2 - y1;
+    clip->stepY = 1;
+    if (clip->dy < 0)
+    {
+        clip->dy = -(clip->dy);
+        clip->stepY = -1;
+    }
+    isXLonger = clip->dx > clip->dy;
+    longer = isXLonger ? clip->dx : clip->dy;
+    shorter = isXLonger ? clip->dy : clip->dx;
+
+    /* Steps inside along the longer axis, then the cells moved along the
+     * shorter axis which are inside */
+    isInside = isXLonger ? clipAxis(x1, x2, left, right, &first, &last) &&
+                           clipAxis(y1, y2, top, bottom, &lowest, &highest)
+                         : clipAxis(y1, y2, top, bottom, &first, &last) &&
+                           clipAxis(x1, x2, left, right, &lowest, &highest);
+
+    if (isInside && shorter > 0)
+    {
+        /* The first step reaching 'lowest', and the last before passing
+         * 'highest', which the end of the line never does */
+        sum = (long) lowest * longer - longer / 2;
+        if (sum > 0 && first < (int) ((sum + shorter - 1) / shorter))
+        {
+            first = (int) ((sum + shorter - 1) / shorter);
+        }
+        if (highest < shorter)
+        {
+            sum = (long) (highest + 1) * longer - longer / 2 - 1;
+            if (last > (int) (sum / shorter))
+            {
+                last = (int) (sum / shorter);
+            }
+        }
+        isInside = first <= last;
+    }
+
+    if (isInside)
+    {
+        clip->first = first;
+        clip->last = last;
+        getStep(clip, isXLonger, x1, y1, first, &(clip->x), &(clip->y),
+                &(clip->decision));
+        getStep(clip, isXLonger, x1, y1, last, &(clip->endX), &(clip->endY),
+                &decision);
+    }
+
+    return isInside;
+}
+
+/**
+ * Finds the tile holding a cell, allocating an empty one the first time, and
+ * makes sure it is on the list of dirty tiles so it is written by the next
+ * Canvas_emit(). The caller widens the tile's dirty area to cover the cells it
+ * plots. Tiles never move once allocated, but two threads must not look up
+ * tiles of the same canvas at once.
+ *
+ * Parameters:
+ *  canvas - the Canvas to find the tile in
+ *  x      - the column of a cell in the tile
+ *  y      - the row of a cell in the tile
+ * Returns:
+ *  the tile, or NULL if memory ran out
+ */
+CanvasTile* Canvas_touchTile(Canvas* canvas, int x, int y)
+{
+    int left, top, capacity;
+    CanvasTile** slot;
+    CanvasTile** dirtyTiles;
+    CanvasTile* tile = NULL;
+
+    left = getTileOrigin(x);
+    top = getTileOrigin(y);
+    slot = findSlot(canvas, left, top);
+    if (*slot == NULL)
+    {
+        /* Keep the table at most half full so probes stay short */
+        if ((canvas->numTiles + 1) * 2 > canvas->tableSize)
+        {
+            slot = growTable(canvas) ? findSlot(canvas, left, top) : NULL;
+        }
+        if (slot != NULL)
+        {
+            tile = (CanvasTile*) Arena_alloc(canvas->arena, sizeof(CanvasTile));
+        }
+        if (tile != NULL)
+        {
+            memset(tile->cells, 0, sizeof(tile->cells));
+            tile->left = left;
+            tile->top = top;
+            memset(tile->dirtyLeft, CANVAS_TILE_SIZE, sizeof(tile->dirtyLeft));
+            memset(tile->dirtyRight, -1, sizeof(tile->dirtyRight));
+            tile->dirtyTop = CANVAS_TILE_SIZE;
+            tile->dirtyBottom = -1;
+            tile->isDirty = FALSE;
+            *slot = tile;
+            canvas->numTiles++;
+        }
+    }
+    else
+    {
+        tile = *slot;
+    }
+
+    if (tile != NULL && !tile->isDirty)
+    {
+        if (canvas->numDirty == canvas->dirtyCapacity)
+        {
+            capacity = canvas->dirtyCapacity == 0 ? 64 : canvas->dirtyCapacity * 2;
+            dirtyTiles = (CanvasTile**) realloc(canvas->dirtyTiles,
+                                                capacity * sizeof(CanvasTile*));
+            if (dirtyTiles != NULL)
+            {
+                canvas->dirtyTiles = dirtyTiles;
+                canvas->dirtyCapacity = capacity;
+            }
+        }
+        if (canvas->numDirty < canvas->dirtyCapacity)
+        {
+            canvas->dirtyTiles[canvas->numDirty] = tile;
+            canvas->numDirty++;
+            tile->isDirty = TRUE;
+        }
+        else
+        {
+            tile = NULL;
+        }
+    }
+
+    return tile;
+}
+
+/**
+ * Finds the smallest rectangle holding every cell drawn on the canvas.
+ *
+ * Parameters:
+ *  canvas - the Canvas to measure
+ *  left   - (export) the first column with a drawn cell
+ *  top    - (export) the first row with a drawn cell
+ *  right  - (export) the last column with a drawn cell
+ *  bottom - (export) the last row with a drawn cell
+ * Returns:
+ *  true(non-zero) if anything was drawn, false(zero) if the canvas is empty
+ */
+int Canvas_getBounds(Canvas* canvas, int* left, int* top, int* right, int* bottom)
+{
+    int ii, row, column, x, y;
+    CanvasTile* tile;
+    int isDrawn = FALSE;
+
+    for (ii = 0; ii < canvas->tableSize; ii++)
+    {
+        tile = canvas->table[ii];
+        for (row = 0; tile != NULL && row < CANVAS_TILE_SIZE; row++)
+        {
+            for (column = 0; column < CANVAS_TILE_SIZE; column++)
+            {
+                if (tile->cells[row * CANVAS_TILE_SIZE + column].pattern != '\0')
+                {
+                    x = tile->left + column;
+                    y = tile->top + row;
+                    if (!isDrawn || x < *left)
+                    {
+                        *left = x;
+                    }
+                    if (!isDrawn || x > *right)
+                    {
+                        *right = x;
+                    }
+                    if (!isDrawn || y < *top)
+                    {
+                        *top = y;
+                    }
+                    if (!isDrawn || y > *bottom)
+                    {
+                        *bottom = y;
+                    }
+                    isDrawn = TRUE;
+                }
+            }
+        }
+    }
+
+    return isDrawn;
+}
+
+/**
+ * Copies part of a row of the canvas, which may reach past the viewport and
+ * past anything drawn. Cells which were never drawn are copied as empty cells.
+ *
+ * Parameters:
+ *  canvas - the Canvas to copy from
+ *  y      - the row to copy
+ *  left   - the first column to copy, with left + width - 1 at most INT_MAX
+ *  width  - the number of cells to copy
+ *  cells  - (export) the copied cells
+ */
+void Canvas_copyRow(Canvas* canvas, int y, int left, int width, Cell* cells)
+{
+    int ii, x, tileLeft, tileTop, count;
+    CanvasTile* tile;
+
+    tileTop = getTileOrigin(y);
+    ii = 0;
+    while (ii < width)
+    {
+        /* Copy up to the end of the tile in one go */
+        x = left + ii;
+        tileLeft = getTileOrigin(x);
+        count = CANVAS_TILE_SIZE - (x - tileLeft);
+        if (count > width - ii)
+        {
+            count = width - ii;
+        }
+
+        tile = *findSlot(canvas, tileLeft, tileTop);
+        if (tile != NULL)
+        {
+            memcpy(&(cells[ii]), &(tile->cells[(y - tileTop) * CANVAS_TILE_SIZE +
+                                               x - tileLeft]), count * sizeof(Cell));
+        }
+        else
+        {
+            memset(&(cells[ii]), 0, count * sizeof(Cell));
+        }
+        ii += count;
+    }
+}
+
+/**
+ * Writes the cells plotted since the canvas was last written to the Terminal's
+ * buffer. The dirty tiles are sorted so the cells are written row by row from
+ * left to right. The cursor is only moved at the start of each run of adjacent
+ * drawn cells, and the colours are only changed when they differ from the
+ * previous cell written. Calling this once at the end writes the whole drawing,
+ * while calling it after every few commands shows the drawing as it is made.
+ * The caller flushes the Terminal.
+ *
+ * Parameters:
+ *  canvas   - the Canvas to write
+ *  terminal - the Terminal to write to
+ * Returns:
+ *  the number of bytes of escape codes written, not counting the cells
+ */
+long Canvas_emit(Canvas* canvas, Terminal* terminal)
+{
+    CanvasTile* tile;
+    Cell* cell;
+    int first, last, ii, row, column, top, bottom;
+    long numEscapeBytes = 0;
+
+    if (canvas->numDirty > 1)
+    {
+        qsort(canvas->dirtyTiles, canvas->numDirty, sizeof(CanvasTile*), &compareTiles);
+    }
+
+    first = 0;
+    while (first < canvas->numDirty)
+    {
+        /* Write the dirty tiles along one row of tiles together */
+        top = CANVAS_TILE_SIZE;
+        bottom = -1;
+        last = first;
+        while (last < canvas->numDirty &&
+               canvas->dirtyTiles[last]->top == canvas->dirtyTiles[first]->top)
+        {
+            tile = canvas->dirtyTiles[last];
+            if (tile->dirtyTop < top)
+            {
+                top = tile->dirtyTop;
+            }
+            if (tile->dirtyBottom > bottom)
+            {
+                bottom = tile->dirtyBottom;
+            }
+            last++;
+        }
+
+        for (row = top; row <= bottom; row++)
+        {
+            for (ii = first; ii < last; ii++)
+            {
+                tile = canvas->dirtyTiles[ii];
+                for (column = tile->dirtyLeft[row]; column <= tile->dirtyRight[row];
+                     column++)
+                {
+                    cell = &(tile->cells[row * CANVAS_TILE_SIZE + column]);
+                    if (cell->pattern != '\0')
+                    {
+                        /* Nothing is written to move within a run */
+                        numEscapeBytes += Terminal_moveTo(terminal,
+                            tile->left - canvas->left + column,
+                            tile->top - canvas->top + row);
+                        numEscapeBytes += Terminal_setColours(terminal, cell->fgColour,
+                                                              cell->bgColour);
+                        Terminal_putChar(terminal, cell->pattern);
+                    }
+                }
+            }
+        }
+
+        for (ii = first; ii < last; ii++)
+        {
+            tile = canvas->dirtyTiles[ii];
+            memset(tile->dirtyLeft, CANVAS_TILE_SIZE, sizeof(tile->dirtyLeft));
+            memset(tile->dirtyRight, -1, sizeof(tile->dirtyRight));
+            tile->dirtyTop = CANVAS_TILE_SIZE;
+            tile->dirtyBottom = -1;
+            tile->isDirty = FALSE;
+        }
+        first = last;
+    }
+    canvas->numDirty = 0;
+
+    return numEscapeBytes;
+}
+
+/**
+ * Frees the memory allocated to a Canvas. All of its tiles are released at
+ * once with the Arena.
+ *
+ * Parameters:
+ *  canvas - the Canvas to free
+ */
+void Canvas_free(Canvas* canvas)
+{
+    if (canvas != NULL)
+    {
+        Arena_free(canvas->arena);
+        free(canvas->table);
+        free(canvas->dirtyTiles);
+        free(canvas);
+    }
+}
+
+/**
+ * A private function that plots a single cell with the current pen, replacing
+ * whatever was in the cell before and ignoring cells outside the viewport.
+ */
+static void Canvas_plotCell(Canvas* canvas, int x, int y)
+{
+    CanvasTile* tile;
+    int column, row;
+
+    if (x >= canvas->left && x <= canvas->right &&
+        y >= canvas->top && y <= canvas->bottom)
+    {
+        /* The differences are unsigned so cells left of or above the last
+         * tile are also too far from it */
+        tile = canvas->lastTile;
+        if (tile == NULL || !tile->isDirty ||
+            (unsigned int) x - (unsigned int) tile->left >= CANVAS_TILE_SIZE ||
+            (unsigned int) y - (unsigned int) tile->top >= CANVAS_TILE_SIZE)
+        {
+            tile = Canvas_touchTile(canvas, x, y);
+            canvas->lastTile = tile;
+        }
+
+        if (tile != NULL)
+        {
+            column = x - tile->left;
+            row = y - tile->top;
+            tile->cells[row * CANVAS_TILE_SIZE + column] = canvas->pen;
+            STATS_COUNT(cellsPlotted, 1);
+            /* Widen the dirty area to cover the cell */
+            if (column < tile->dirtyLeft[row])
+            {
+                tile->dirtyLeft[row] = (signed char) column;
+            }
+            if (column > tile->dirtyRight[row])
+            {
+                tile->dirtyRight[row] = (signed char) column;
+            }
+            if (row < tile->dirtyTop)
+            {
+                tile->dirtyTop = row;
+            }
+            if (row > tile->dirtyBottom)
+            {
+                tile->dirtyBottom = row;
+            }
+        }
+    }
+}
+
+/**
+ * A private function that plots a cell of a line with Canvas_plotCell(), in the
+ * form Canvas_stepLine() calls.
+ */
+static void Canvas_plotLineCell(int x, int y, void* canvas)
+{
+    Canvas_plotCell((Canvas*) canvas, x, y);
+}
+
+/**
+ * A private function that plots every cell of a row from the left column to
+ * the right column with the current pen, a tile at a time. The part of the
+ * span outside the viewport is ignored.
+ */
+static void Canvas_plotSpan(Canvas* canvas, int y, int left, int right)
+{
+    CanvasTile* tile;
+    Cell* cell;
+    Cell* end;
+    int tileRight, row;
+    int isDone;
+
+    if (left < canvas->left)
+    {
+        left = canvas->left;
+    }
+    if (right > canvas->right)
+    {
+        right = canvas->right;
+    }
+
+    isDone = y < canvas->top || y > canvas->bottom || left > right;
+    while (!isDone)
+    {
+        tileRight = getTileOrigin(left) + (CANVAS_TILE_SIZE - 1);
+        if (tileRight > right)
+        {
+            tileRight = right;
+        }
+
+        tile = Canvas_touchTile(canvas, left, y);
+        canvas->lastTile = tile;
+        if (tile != NULL)
+        {
+            row = y - tile->top;
+            end = &(tile->cells[row * CANVAS_TILE_SIZE + tileRight - tile->left]);
+            for (cell = &(tile->cells[row * CANVAS_TILE_SIZE + left - tile->left]);
+                 cell <= end; cell++)
+            {
+                *cell = canvas->pen;
+            }
+            STATS_COUNT(cellsPlotted, tileRight - left + 1);
+            if (left - tile->left < tile->dirtyLeft[row])
+            {
+                tile->dirtyLeft[row] = (signed char) (left - tile->left);
+            }
+            if (tileRight - tile->left > tile->dirtyRight[row])
+            {
+                tile->dirtyRight[row] = (signed char) (tileRight - tile->left);
+            }
+            if (row < tile->dirtyTop)
+            {
+                tile->dirtyTop = row;
+            }
+            if (row > tile->dirtyBottom)
+            {
+                tile->dirtyBottom = row;
+            }
+        }
+
+        /* Checked before stepping on, as the last tile may end at INT_MAX */
+        isDone = tileRight == right;
+        left = tileRight + 1;
+    }
+}
+
+/**
+ * A private function that finds how far along one axis a line is inside the
+ * range from 'low' to 'high', counted in cells from its start. The range is
+ * cut to the line first, so nothing is subtracted which could overflow.
+ *
+ * Returns:
+ *  true(non-zero) if any of the line is inside the range, false(zero)
+ *  otherwise
+ */
+static int clipAxis(int start, int end, int low, int high, int* first, int* last)
+{
+    int isInside;
+
+    if (start <= end)
+    {
+        low = low > start ? low : start;
+        high = high < end ? high : end;
+        isInside = low <= high;
+        *first = low - start;
+        *last = high - start;
+    }
+    else
+    {
+        low = low > end ? low : end;
+        high = high < start ? high : start;
+        isInside = low <= high;
+        *first = start - high;
+        *last = start - low;
+    }
+
+    return isInside;
+}
+
+/**
+ * A private function that finds the cell of a clipped line after a number of
+ * steps, and the decision Bresenham's algorithm has at that cell.
+ */
+static void getStep(ClippedLine* clip, int isXLonger, int x1, int y1, int step,
+                    int* x, int* y, int* decision)
+{
+    int longer, shorter, across;
+    long sum;
+
+    longer = isXLonger ? clip->dx : clip->dy;
+    shorter = isXLonger ? clip->dy : clip->dx;
+    sum = longer / 2 + (long) step * shorter;
+    across = longer == 0 ? 0 : (int) (sum / longer);
+    *decision = longer == 0 ? 0 : (int) (sum % longer);
+    if (isXLonger)
+    {
+        *x = x1 + clip->stepX * step;
+        *y = y1 + clip->stepY * across;
+    }
+    else
+    {
+        *x = x1 + clip->stepX * across;
+        *y = y1 + clip->stepY * step;
+    }
+}
+
+/**
+ * A private function that finds the first row or column of the tile holding
+ * row or column 'n'.
+ */
+static int getTileOrigin(int n)
+{
+    return floorDivide(n, CANVAS_TILE_SIZE) * CANVAS_TILE_SIZE;
+}
+
+/**
+ * A private function that finds the slot of the hash table holding the tile
+ * whose top left cell is (left, top), or the empty slot where it would go. The
+ * table always has an empty slot, so the search ends.
+ */
+static CanvasTile** findSlot(Canvas* canvas, int left, int top)
+{
+    unsigned int hash, mask;
+    CanvasTile* tile;
+
+    /* Mix the tile's column and row of tiles so neighbours spread out */
+    hash = ((unsigned int) left / CANVAS_TILE_SIZE) * 73856093U ^
+           ((unsigned int) top / CANVAS_TILE_SIZE) * 19349663U;
+    hash ^= hash >> 15;
+    mask = (unsigned int) canvas->tableSize - 1;
+    hash &= mask;
+
+    tile = canvas->table[hash];
+    while (tile != NULL && (tile->left != left || tile->top != top))
+    {
+        hash = (hash + 1) & mask;
+        tile = canvas->table[hash];
+    }
+
+    return &(canvas->table[hash]);
+}
+
+/**
+ * A private function that doubles the number of slots in the hash table and
+ * moves every tile into its slot of the new table.
+ *
+ * Returns:
+ *  true(non-zero) if the table grew, false(zero) if memory ran out
+ */
+static int growTable(Canvas* canvas)
+{
+    CanvasTile** oldTable = canvas->table;
+    int oldSize = canvas->tableSize;
+    int ii;
+    int isGrown = FALSE;
+
+    canvas->table = (CanvasTile**) calloc(oldSize * 2, sizeof(CanvasTile*));
+    if (canvas->table != NULL)
+    {
+        canvas->tableSize = oldSize * 2;
+        for (ii = 0; ii < oldSize; ii++)
+        {
+            if (oldTable[ii] != NULL)
+            {
+                *findSlot(canvas, oldTable[ii]->left, oldTable[ii]->top) = oldTable[ii];
+            }
+        }
+        free(oldTable);
+        isGrown = TRUE;
+    }
+    else
+    {
+        canvas->table = oldTable;
+    }
+
+    return isGrown;
+}
+
+/**
+ * A private function that orders tiles by row, then by column, for qsort().
+ */
+static int compareTiles(const void* first, const void* second)
+{
+    const CanvasTile* tile1 = *((CanvasTile* const*) first);
+    const CanvasTile* tile2 = *((CanvasTile* const*) second);
+    int order;
+
+    if (tile1->top != tile2->top)
+    {
+        order = tile1->top < tile2->top ? -1 : 1;
+    }
+    else
+    {
+        order = tile1->left < tile2->left ? -1 : (tile1->left > tile2->left);
+    }
+
+    return order;
+}
@@ -0,0 +1,132 @@
+#ifndef CANVAS_H
+#define CANVAS_H
+
+#include "arena.h"
+#include "terminal.h"
+
+/* Cells past this row or column are beyond any terminal, so the canvas only
+ * keeps this many rows and columns unless it is given a viewport */
+#define MAX_CANVAS_SIZE 10000
+
+/* Number of cells along each side of a tile of the canvas, a power of two */
+#define CANVAS_TILE_SIZE 32
+
+/**
+ * A struct representing a single character cell of the canvas. A pattern of
+ * '\0' means nothing has been drawn in the cell.
+ */
+typedef struct
+{
+    char pattern;
+    signed char fgColour;
+    signed char bgColour;
+} Cell;
+
+/**
+ * A struct representing a square tile of CANVAS_TILE_SIZE cells along each
+ * side, which is only allocated once a cell in it is drawn. 'left' and 'top'
+ * are the column and row of its top left cell, always multiples of the tile
+ * size. The dirty rows, and the dirty columns of each row, hold the cells
+ * plotted since the canvas was last written, counted from the tile's top left
+ * and empty when the first is greater than the last. The tile is on the
+ * canvas's list of dirty tiles while 'isDirty' is set.
+ */
+typedef struct
+{
+    int left;
+    int top;
+    int dirtyTop;
+    int dirtyBottom;
+    signed char dirtyLeft[CANVAS_TILE_SIZE];
+    signed char dirtyRight[CANVAS_TILE_SIZE];
+    int isDirty;
+    Cell cells[CANVAS_TILE_SIZE * CANVAS_TILE_SIZE];
+} CanvasTile;
+
+/**
+ * A struct representing the part of a line inside a rectangle, as drawn by
+ * Bresenham's algorithm. The line moves 'dx' columns and 'dy' rows in the
+ * directions of stepX and stepY, taking one step at a time along the longer of
+ * the two. The steps from 'first' to 'last' are inside, starting at the cell
+ * (x, y) with the decision the algorithm has reached by then, and ending at
+ * (endX, endY).
+ */
+typedef struct
+{
+    int dx;
+    int dy;
+    int stepX;
+    int stepY;
+    int first;
+    int last;
+    int x;
+    int y;
+    int decision;
+    int endX;
+    int endY;
+} ClippedLine;
+
+/**
+ * Defines the functions Canvas_stepLine() plots each cell of a line with,
+ * given the column and row of the cell.
+ */
+typedef void (* CellPlotFunc)(int x, int y, void* plotData);
+
+/**
+ * A struct representing an off-screen canvas that lines are rasterised into.
+ * The canvas is sparse: its tiles are found by their top left cell in a hash
+ * table of 'tableSize' slots, so rows and columns may be anywhere from INT_MIN
+ * to INT_MAX and memory only grows with the area drawn. Cells outside the
+ * viewport, from (left, top) to (right, bottom), are ignored, and the viewport
+ * is written with its top left in the terminal's top left. The pen holds the
+ * pattern and colours given to the next cell plotted. Each write only covers
+ * the dirty tiles, those plotted since the last one. All tiles are allocated
+ * from an Arena so the canvas is freed in one go.
+ */
+typedef struct
+{
+    Arena* arena;
+    CanvasTile** table;
+    int tableSize;
+    int numTiles;
+    CanvasTile** dirtyTiles;
+    int numDirty;
+    int dirtyCapacity;
+    CanvasTile* lastTile;
+    int left;
+    int top;
+    int right;
+    int bottom;
+    Cell pen;
+} Canvas;
+
+Canvas* Canvas_create();
+
+void Canvas_reset(Canvas* canvas);
+
+void Canvas_setViewport(Canvas* canvas, int left, int top, int right, int bottom);
+
+void Canvas_setPattern(Canvas* canvas, char pattern);
+
+void Canvas_setFgColour(Canvas* canvas, int code);
+
+void Canvas_setBgColour(Canvas* canvas, int code);
+
+void Canvas_drawLine(Canvas* canvas, int x1, int y1, int x2, int y2);
+
+int Canvas_clipLine(int x1, int y1, int x2, int y2, int left, int top,
+                    int right, int bottom, ClippedLine* clip);
+
+void Canvas_stepLine(ClippedLine* clip, CellPlotFunc plotter, void* plotData);
+
+CanvasTile* Canvas_touchTile(Canvas* canvas, int x, int y);
+
+int Canvas_getBounds(Canvas* canvas, int* left, int* top, int* right, int* bottom);
+
+void Canvas_copyRow(Canvas* canvas, int y, int left, int width, Cell* cells);
+
+long Canvas_emit(Canvas* canvas, Terminal* terminal);
+
+void Canvas_free(Canvas* canvas);
+
+#endif
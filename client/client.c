@@ -0,0 +1,250 @@
+/**
+ * Sends a command file to TurtleGraphics running with --serve and writes the
+ * frame it draws to stdout, so the server can be used and tested without any
+ * other tools. The request is the name of the format on a line of its own
+ * followed by the commands, and the response is the status and the size of
+ * the frame on a line of their own followed by the frame.
+ *
+ * Usage: ./TurtleClient <socketName> <format> [commandsFile]
+ *
+ *  format       - ansi for the terminal's escape codes, text for the
+ *                 characters drawn, or ppm, pgm or pbm for an image
+ *  commandsFile - the commands to draw, or - or nothing for stdin
+ */
+
+/* Sockets are POSIX, not C89 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "../boolean.h"
+
+/* Number of bytes read and sent at a time */
+#define COPY_SIZE 65536
+
+/* Maximum number of characters in the status line of a response */
+#define STATUS_LENGTH 64
+
+static int connectTo(char* socketName);
+
+static int sendFile(int connection, FILE* file);
+
+static int readStatus(int connection, int* status, long* frameSize);
+
+static int sendAll(int connection, const char* bytes, size_t length);
+
+/**
+ * Parameters:
+ *  argc - three or four
+ *  argv - executableName, socketName, format, [commandsFile]
+ * Returns:
+ *  the status sent by the server, 1 for invalid arguments or if the commands
+ *  file could not be opened, or 3 if the server could not be reached
+ */
+int main(int argc, char* argv[])
+{
+    int errNo = 0;
+    int connection = -1;
+    FILE* commands = stdin;
+    char buffer[COPY_SIZE];
+    long frameSize, numRead;
+    int status;
+
+    if (argc != 3 && argc != 4)
+    {
+        errNo = 1;
+        fprintf(stderr, "Usage: %s <socketName> <ansi | text | ppm | pgm | pbm> "
+                "[commandsFile]\n", argv[0]);
+    }
+    else if (argc == 4 && strcmp(argv[3], "-") != 0)
+    {
+        commands = fopen(argv[3], "rb");
+        if (commands == NULL)
+        {
+            errNo = 1;
+            perror("ERROR: The commands file could not be opened");
+        }
+    }
+
+    if (errNo == 0)
+    {
+        connection = connectTo(argv[1]);
+        if (connection < 0)
+        {
+            errNo = 3;
+        }
+    }
+
+    if (errNo == 0)
+    {
+        /* The server stops reading a request which is too large or too slow, so
+         * the rest may not be sent, but the status still arrives */
+        signal(SIGPIPE, SIG_IGN);
+        if (sendAll(connection, argv[2], strlen(argv[2])) &&
+            sendAll(connection, "\n", 1) && sendFile(connection, commands))
+        {
+            shutdown(connection, SHUT_WR);
+        }
+        if (!readStatus(connection, &status, &frameSize))
+        {
+            errNo = 3;
+            fprintf(stderr, "ERROR: The server did not answer the request.\n");
+        }
+        else
+        {
+            errNo = status;
+            /* Copy the frame as it arrives */
+            do
+            {
+                numRead = (long) read(connection, buffer, COPY_SIZE);
+                if (numRead > 0)
+                {
+                    fwrite(buffer, 1, (size_t) numRead, stdout);
+                    frameSize -= numRead;
+                }
+            }
+            while (numRead > 0 || (numRead < 0 && errno == EINTR));
+
+            if (frameSize != 0 || fflush(stdout) != 0)
+            {
+                errNo = 3;
+                fprintf(stderr, "ERROR: The frame was not received whole.\n");
+            }
+        }
+        close(connection);
+    }
+
+    if (commands != NULL && commands != stdin)
+    {
+        fclose(commands);
+    }
+
+    return errNo;
+}
+
+/**
+ * A private function that connects to the server's socket.
+ *
+ * Returns:
+ *  the connection, or -1 if the server could not be reached
+ */
+static int connectTo(char* socketName)
+{
+    int connection = -1;
+    struct sockaddr_un address;
+
+    if (strlen(socketName) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "ERROR: The socket name is too long.\n");
+    }
+    else
+    {
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strcpy(address.sun_path, socketName);
+
+        connection = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connection < 0 ||
+            connect(connection, (struct sockaddr*) &address, sizeof(address)) != 0)
+        {
+            perror("ERROR: Could not connect to the server");
+            if (connection >= 0)
+            {
+                close(connection);
+                connection = -1;
+            }
+        }
+    }
+
+    return connection;
+}
+
+/**
+ * A private function that sends the whole of a file to the server.
+ *
+ * Returns:
+ *  true(non-zero) on success, false(zero) otherwise
+ */
+static int sendFile(int connection, FILE* file)
+{
+    char buffer[COPY_SIZE];
+    size_t numRead;
+    int isSent = TRUE;
+
+    do
+    {
+        numRead = fread(buffer, 1, COPY_SIZE, file);
+        isSent = sendAll(connection, buffer, numRead);
+    }
+    while (isSent && numRead == COPY_SIZE);
+
+    return isSent && !ferror(file);
+}
+
+/**
+ * A private function that reads the status line of the response, one byte at
+ * a time so none of the frame is read with it.
+ *
+ * Parameters:
+ *  connection - the connection to the server
+ *  status     - (export) the status of the request
+ *  frameSize  - (export) the number of bytes in the frame
+ * Returns:
+ *  true(non-zero) on success, false(zero) if the line could not be read
+ */
+static int readStatus(int connection, int* status, long* frameSize)
+{
+    char line[STATUS_LENGTH];
+    int length = 0;
+    long numRead;
+
+    do
+    {
+        numRead = (long) read(connection, line + length, 1);
+        if (numRead == 1)
+        {
+            length++;
+        }
+    }
+    while ((numRead == 1 && line[length - 1] != '\n' && length < STATUS_LENGTH - 1) ||
+           (numRead < 0 && errno == EINTR));
+    line[length] = '\0';
+
+    return length > 0 && line[length - 1] == '\n' &&
+           sscanf(line, "%d %ld", status, frameSize) == 2;
+}
+
+/**
+ * A private function that writes all of the bytes to the connection, however
+ * many calls to write() it takes.
+ *
+ * Returns:
+ *  true(non-zero) on success, false(zero) otherwise
+ */
+static int sendAll(int connection, const char* bytes, size_t length)
+{
+    size_t numWritten = 0;
+    long result;
+    int isWritten = TRUE;
+
+    while (numWritten < length && isWritten)
+    {
+        result = (long) write(connection, bytes + numWritten, length - numWritten);
+        if (result > 0)
+        {
+            numWritten += (size_t) result;
+        }
+        else if (result == 0 || errno != EINTR)
+        {
+            isWritten = FALSE;
+        }
+    }
+
+    return isWritten;
+}
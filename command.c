@@ -1,113 +1,427 @@
+/* pthread_once is POSIX, not C89 */
+#define _POSIX_C_SOURCE 200112L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <pthread.h>
 #include "command.h"
 
-#define LOG_FORMAT "%s (%7.3f, %7.3f)-(%7.3f, %7.3f)\n"
+/* Number of slots in the command name hash table, a power of two which is at
+ * least twice NUM_COMMANDS */
+#define HASH_SIZE 16
+
+static void executeRotate(TurtleSettings* settings, Canvas* canvas,
+                          CommandValue* value, LogWriter* log);
+
+static void executeMove(TurtleSettings* settings, Canvas* canvas,
+                        CommandValue* value, LogWriter* log);
+
+static void executeDraw(TurtleSettings* settings, Canvas* canvas,
+                        CommandValue* value, LogWriter* log);
+
+static void executeFg(TurtleSettings* settings, Canvas* canvas,
+                      CommandValue* value, LogWriter* log);
+
+static void executeBg(TurtleSettings* settings, Canvas* canvas,
+                      CommandValue* value, LogWriter* log);
+
+static void executePattern(TurtleSettings* settings, Canvas* canvas,
+                           CommandValue* value, LogWriter* log);
+
+static void drawGeometry(TurtleSettings* settings, Canvas* canvas,
+                         Program* program, int count, Geometry* geometry,
+                         TileRenderer* renderer, LogWriter* log);
+
+static void buildHashTable();
+
+static unsigned int hashName(const char* name);
+
+/* Every command, indexed by opcode. The value range only applies to INT_ARG
+ * commands. Adding a command only requires an entry here and its opcode. */
+static const CommandInfo CMD_TABLE[NUM_COMMANDS] =
+{
+    { "ROTATE", REAL_ARG, 0, 0, &executeRotate },
+    { "MOVE", REAL_ARG, 0, 0, &executeMove },
+    { "DRAW", REAL_ARG, 0, 0, &executeDraw },
+    { "FG", INT_ARG, MIN_COL_CODE, MAX_FG_CODE, &executeFg },
+    { "BG", INT_ARG, MIN_COL_CODE, MAX_BG_CODE, &executeBg },
+    { "PATTERN", CHAR_ARG, 0, 0, &executePattern },
+    { "REPEAT", INT_ARG, 0, MAX_REPEAT_COUNT, NULL },
+    { "END", NO_ARG, 0, 0, NULL }
+};
+
+/* Opcodes of the commands, placed by the hash of their names. The table is
+ * built once, by whichever thread looks up a name first */
+static int hashTable[HASH_SIZE];
+static pthread_once_t hashTableOnce = PTHREAD_ONCE_INIT;
 
 /**
- * Allocates the appropriate amount of memory for a command. The memory allocated
- * depends on the name of the command, as the void pointer can take on either a
- * double, int, or char.
+ * Converts the name of a command into its opcode by looking it up in a hash
+ * table of the command names, so the name is only compared once when the file
+ * is read. The hash table is built from CMD_TABLE the first time it is used,
+ * and can be used by several threads at once.
  *
- * Parmaeters:
- *  name  - the name of the command in uppercase, e.g. MOVE
- *  len   - the length of the name characterv array
- *  value - the value of the command ,e.g. 5.0
+ * Parameters:
+ *  cmdName - the name of the command in uppercase, e.g. MOVE
  * Returns:
- *  command - the Command struct created and malloc'ed from the imports
+ *  opcode - the opcode of the command, or INVALID_OPCODE if it does not exist
  */
-Command* createCommand(char name[], size_t len, void* value)
+int getOpcode(char cmdName[])
 {
-    Command* command = (Command*) malloc(sizeof(Command));
+    unsigned int slot;
+    int opcode = INVALID_OPCODE;
 
-    if (isCommandWithRealArg(name))
-    {
-        command->value = malloc(sizeof(double));
-        memcpy(command->value, value, sizeof(double));
-    }
-    else if (isCommandWithIntArg(name))
+    pthread_once(&hashTableOnce, &buildHashTable);
+    slot = hashName(cmdName);
+    while (hashTable[slot] != INVALID_OPCODE && opcode == INVALID_OPCODE)
     {
-        command->value = malloc(sizeof(int));
-        memcpy(command->value, value, sizeof(int));
-    }
-    else if (isCommandWithCharArg(name))
-    {
-        command->value = malloc(sizeof(char));
-        memcpy(command->value, value, sizeof(char));
+        if (strcmp(cmdName, CMD_TABLE[hashTable[slot]].name) == 0)
+        {
+            opcode = hashTable[slot];
+        }
+        slot = (slot + 1) & (HASH_SIZE - 1);
     }
 
-    strncpy(command->name.value, name, len);
-    command->name.length = len;
+    return opcode;
+}
+
+/**
+ * Returns the CommandInfo describing the command with the opcode.
+ */
+const CommandInfo* getCommandInfo(int opcode)
+{
+    return &(CMD_TABLE[opcode]);
+}
 
-    return command;
+/**
+ * Executes a command by calling its function from the command table, which
+ * updates the settings struct with the result of the command.
+ *
+ * Parameters:
+ *  settings - the TurtleSettings struct which holds the current options
+ *  canvas   - the Canvas to draw lines on
+ *  opcode   - the opcode of the command to execute
+ *  value    - the value of the command to execute
+ *  log      - the LogWriter to record MOVE and DRAW commands in
+ */
+void executeCommand(TurtleSettings* settings, Canvas* canvas, int opcode,
+                    CommandValue* value, LogWriter* log)
+{
+    (*CMD_TABLE[opcode].execute)(settings, canvas, value, log);
 }
 
 /**
- * Executes a command located in the Command struct and updates the settings struct
- * with the result of the command. The log file is printed to when a DRAW or MOVE
- * command is executed. The log file prints the coordinates before and after the
- * move or draw.
+ * Executes the commands of a program from where the ProgramCounter is, stopping
+ * before a command if the cursor is off the top or left of the terminal or the
+ * ProgramCounter has no commands left to execute. The commands are executed in
+ * batches: the positions over the whole batch are worked out first by
+ * Geometry_compute(), which also follows REPEAT blocks, then the lines are
+ * handed to the TileRenderer and logged from them, and the other commands are
+ * executed in order as they are reached. Every line of a batch has been drawn
+ * on the canvas when this returns.
  *
  * Parameters:
  *  settings - the TurtleSettings struct which holds the current options
- *  command  - the Command struct to execute
- *  logFile  - the FILE pointer to print to
+ *  canvas   - the Canvas to draw lines on
+ *  program  - the Program to execute, whose REPEAT blocks have been checked
+ *  counter  - the ProgramCounter to start from, left after the last command
+ *  geometry - the Geometry to work out each batch in
+ *  renderer - the TileRenderer to draw the lines with
+ *  log      - the LogWriter to record MOVE and DRAW commands in
+ * Returns:
+ *  true(non-zero) if every command was executed or no commands were left,
+ *  false(zero) if the cursor went out of bounds first
  */
-void executeCommand(TurtleSettings* settings, Command* command, FILE* logFile)
+int executeProgram(TurtleSettings* settings, Canvas* canvas, Program* program,
+                   ProgramCounter* counter, Geometry* geometry,
+                   TileRenderer* renderer, LogWriter* log)
 {
-    char cmdName[MAX_CMD_NAME_SIZE + 1];
-    double oldX, oldY, newX, newY;
-    double deltaX, deltaY;
+    int count;
+    int isInBounds = TRUE;
 
-    strncpy(cmdName, command->name.value, MAX_CMD_NAME_SIZE + 1);
-    if (strcmp(cmdName, "ROTATE") == 0)
+    while (counter->next < program->size && counter->numLeft != 0 && isInBounds)
     {
-        rotate(settings, *((double*) command->value));
+        count = Geometry_compute(geometry, settings, program, counter);
+        drawGeometry(settings, canvas, program, count, geometry, renderer, log);
+        TileRenderer_flush(renderer, canvas);
+        isInBounds = counter->next == program->size ||
+                     isPositionValid(settings, settings->pos.x, settings->pos.y);
     }
-    else if (strcmp(cmdName, "MOVE") == 0)
+
+    return isInBounds;
+}
+
+/**
+ * Checks that every REPEAT block of a Program is closed by an END and nested at
+ * most MAX_REPEAT_DEPTH deep, which has to be done once the whole block has
+ * been read. Each time its body is executed a block must also execute a
+ * command other than REPEAT and END, so a block which is empty or holds only
+ * blocks like that, or blocks repeated zero times, is wrong too; executing it
+ * would take time without doing anything. The commands before the first one
+ * which is wrong can still be executed.
+ *
+ * Parameters:
+ *  program  - the Program to check
+ *  numValid - (export) the number of commands before the first END which does
+ *             not close a block, the first REPEAT nested too deeply, or the
+ *             outermost REPEAT of a block with nothing to execute or which is
+ *             not closed, or the size of the Program
+ *  errors   - the stream to print the error to, or NULL to print nothing
+ * Returns:
+ *   0 - if every block is closed and executes a command
+ *  10 - otherwise
+ */
+int checkRepeats(Program* program, int* numValid, FILE* errors)
+{
+    int errNo = 0;
+    int ii, depth;
+    int outermost = 0;
+    int blockStart[MAX_REPEAT_DEPTH];
+    int hasCommand[MAX_REPEAT_DEPTH];
+
+    depth = 0;
+    for (ii = 0; ii < program->size && errNo == 0; ii++)
     {
-        getPos(settings, &oldX, &oldY);
-        move(settings, *((double*) command->value), &deltaX, &deltaY);
-        getPos(settings, &newX, &newY);
-        fprintf(logFile, LOG_FORMAT, cmdName, oldX, oldY, newX, newY);
-        #ifdef PRINT_LOG
-        fprintf(stderr, LOG_FORMAT, cmdName, oldX, oldY, newX, newY);
-        #endif
+        if (program->opcodes[ii] == CMD_REPEAT)
+        {
+            if (depth == 0)
+            {
+                outermost = ii;
+            }
+            depth++;
+            if (depth > MAX_REPEAT_DEPTH)
+            {
+                errNo = 10; /* Nested too deeply */
+                *numValid = ii;
+                if (errors != NULL)
+                {
+                    fprintf(errors, "ERROR: REPEAT blocks cannot be nested more "
+                                    "than %d deep.\n", MAX_REPEAT_DEPTH);
+                }
+            }
+            else
+            {
+                blockStart[depth - 1] = ii;
+                hasCommand[depth - 1] = FALSE;
+            }
+        }
+        else if (program->opcodes[ii] == CMD_END)
+        {
+            depth--;
+            if (depth < 0)
+            {
+                errNo = 10; /* END without REPEAT */
+                *numValid = ii;
+                if (errors != NULL)
+                {
+                    fprintf(errors, "ERROR: An END does not close a REPEAT.\n");
+                }
+            }
+            else if (!hasCommand[depth])
+            {
+                errNo = 10; /* Nothing to execute */
+                *numValid = outermost;
+                if (errors != NULL)
+                {
+                    fprintf(errors, "ERROR: A REPEAT block has no commands to "
+                                    "execute.\n");
+                }
+            }
+            else if (depth > 0 && program->values[blockStart[depth]].integer > 0)
+            {
+                /* The block executes a command each time its parent does */
+                hasCommand[depth - 1] = TRUE;
+            }
+        }
+        else if (depth > 0)
+        {
+            hasCommand[depth - 1] = TRUE;
+        }
     }
-    else if (strcmp(cmdName, "DRAW") == 0)
+
+    if (errNo == 0 && depth > 0)
     {
-        getPos(settings, &oldX, &oldY);
-        draw(settings, *((double*) command->value), &deltaX, &deltaY);
-        getPos(settings, &newX, &newY);
-        fprintf(logFile, LOG_FORMAT, cmdName, oldX, oldY, newX, newY);
-        #ifdef PRINT_LOG
-        fprintf(stderr, LOG_FORMAT, cmdName, oldX, oldY, newX, newY);
-        #endif
+        errNo = 10; /* REPEAT without END */
+        *numValid = outermost;
+        if (errors != NULL)
+        {
+            fprintf(errors, "ERROR: A REPEAT is not closed by an END.\n");
+        }
     }
-    else if (strcmp(cmdName, "FG") == 0)
+    else if (errNo == 0)
     {
-        settings->fgColour = *((int*) command->value);
-        #ifndef NO_COLOURS
-        setFgColour(settings->fgColour);
-        #endif
+        *numValid = program->size;
     }
-    else if (strcmp(cmdName, "BG") == 0)
+
+    return errNo;
+}
+
+/**
+ * A private function that adds the lines of a batch's DRAW commands to the
+ * renderer and logs its MOVE and DRAW commands from its Geometry. The FG, BG
+ * and PATTERN commands between them are executed as they are reached, so every
+ * line takes the right pen. ROTATE commands have nothing left to do.
+ */
+static void drawGeometry(TurtleSettings* settings, Canvas* canvas,
+                         Program* program, int count, Geometry* geometry,
+                         TileRenderer* renderer, LogWriter* log)
+{
+    int ii, opcode;
+
+    for (ii = 0; ii < count; ii++)
     {
-        settings->bgColour = *((int*) command->value);
-        #ifndef NO_COLOURS
-        setBgColour(settings->bgColour);
-        #endif
+        opcode = program->opcodes[geometry->index[ii]];
+        if (opcode == CMD_MOVE || opcode == CMD_DRAW)
+        {
+            if (opcode == CMD_DRAW)
+            {
+                TileRenderer_add(renderer, canvas, (int) roundNum(geometry->x[ii]),
+                                 (int) roundNum(geometry->y[ii]),
+                                 geometry->endX[ii], geometry->endY[ii]);
+            }
+            LogWriter_write(log, opcode, geometry->x[ii], geometry->y[ii],
+                            geometry->x[ii + 1], geometry->y[ii + 1]);
+            #ifdef PRINT_LOG
+            fprintf(stderr, LOG_FORMAT, CMD_TABLE[opcode].name, geometry->x[ii],
+                    geometry->y[ii], geometry->x[ii + 1], geometry->y[ii + 1]);
+            #endif
+        }
+        else if (opcode != CMD_ROTATE)
+        {
+            executeCommand(settings, canvas, opcode,
+                           &(program->values[geometry->index[ii]]), log);
+        }
     }
-    else if (strcmp(cmdName, "PATTERN") == 0)
+}
+
+/**
+ * Executes a ROTATE command.
+ */
+static void executeRotate(TurtleSettings* settings, Canvas* canvas,
+                          CommandValue* value, LogWriter* log)
+{
+    rotate(settings, value->real);
+}
+
+/**
+ * Executes a MOVE command and records the coordinates before and after the move
+ * in the log.
+ */
+static void executeMove(TurtleSettings* settings, Canvas* canvas,
+                        CommandValue* value, LogWriter* log)
+{
+    double oldX, oldY, newX, newY;
+    double deltaX, deltaY;
+
+    getPos(settings, &oldX, &oldY);
+    move(settings, value->real, &deltaX, &deltaY);
+    getPos(settings, &newX, &newY);
+    LogWriter_write(log, CMD_MOVE, oldX, oldY, newX, newY);
+    #ifdef PRINT_LOG
+    fprintf(stderr, LOG_FORMAT, "MOVE", oldX, oldY, newX, newY);
+    #endif
+}
+
+/**
+ * Executes a DRAW command and records the coordinates before and after the draw
+ * in the log.
+ */
+static void executeDraw(TurtleSettings* settings, Canvas* canvas,
+                        CommandValue* value, LogWriter* log)
+{
+    double oldX, oldY, newX, newY;
+    double deltaX, deltaY;
+
+    getPos(settings, &oldX, &oldY);
+    draw(settings, canvas, value->real, &deltaX, &deltaY);
+    getPos(settings, &newX, &newY);
+    LogWriter_write(log, CMD_DRAW, oldX, oldY, newX, newY);
+    #ifdef PRINT_LOG
+    fprintf(stderr, LOG_FORMAT, "DRAW", oldX, oldY, newX, newY);
+    #endif
+}
+
+/**
+ * Executes an FG command.
+ */
+static void executeFg(TurtleSettings* settings, Canvas* canvas,
+                      CommandValue* value, LogWriter* log)
+{
+    settings->fgColour = value->integer;
+    #ifndef NO_COLOURS
+    Canvas_setFgColour(canvas, settings->fgColour);
+    #endif
+}
+
+/**
+ * Executes a BG command.
+ */
+static void executeBg(TurtleSettings* settings, Canvas* canvas,
+                      CommandValue* value, LogWriter* log)
+{
+    settings->bgColour = value->integer;
+    #ifndef NO_COLOURS
+    Canvas_setBgColour(canvas, settings->bgColour);
+    #endif
+}
+
+/**
+ * Executes a PATTERN command.
+ */
+static void executePattern(TurtleSettings* settings, Canvas* canvas,
+                           CommandValue* value, LogWriter* log)
+{
+    settings->pattern = value->character;
+    Canvas_setPattern(canvas, settings->pattern);
+}
+
+/**
+ * A private function that places the opcode of every command in the hash
+ * table, by the hash of its name.
+ */
+static void buildHashTable()
+{
+    int ii;
+    unsigned int slot;
+
+    for (ii = 0; ii < HASH_SIZE; ii++)
+    {
+        hashTable[ii] = INVALID_OPCODE;
+    }
+    for (ii = 0; ii < NUM_COMMANDS; ii++)
+    {
+        /* Linear probing to the next free slot */
+        slot = hashName(CMD_TABLE[ii].name);
+        while (hashTable[slot] != INVALID_OPCODE)
+        {
+            slot = (slot + 1) & (HASH_SIZE - 1);
+        }
+        hashTable[slot] = ii;
+    }
+}
+
+/**
+ * A private function that hashes the name of a command into a slot of the
+ * hash table.
+ */
+static unsigned int hashName(const char* name)
+{
+    unsigned int hash = 0;
+
+    while (*name != '\0')
     {
-        settings->pattern = *((char*) command->value);
+        hash = hash * 31 + (unsigned char) *name;
+        name++;
     }
+
+    return hash & (HASH_SIZE - 1);
 }
 
 /**
  * Adds the angle from the commmand value to the angle setting in the TurtleSettings
- * struct.
+ * struct, and works out the direction of the new angle for move().
  *
  * Parameters:
  *  settings - the TurtleSettings struct that contains the current settings
@@ -117,11 +431,13 @@ void rotate(TurtleSettings* settings, double angle)
 {
     settings->angle += angle;
     settings->angle = adjustAngle(settings->angle);
+    unitVector(settings->angle, &(settings->direction.x), &(settings->direction.y));
 }
 
 /**
- * Moves the coordinates inside the TurtleSettings struct by a distance calculated
- * by polToRec.
+ * Moves the coordinates inside the TurtleSettings struct by a distance in the
+ * direction of the current angle. The direction is kept up to date by rotate(),
+ * so no trigonometry is needed here.
  *
  * Parameters:
  *  settings - the current setting of the drawing
@@ -132,7 +448,8 @@ void rotate(TurtleSettings* settings, double angle)
 void move(TurtleSettings* settings, double distance, double* deltaX, double* deltaY)
 {
     /* Convert form polar coordinates to cartesian coordinates */
-    polToRec(distance, settings->angle, deltaX, deltaY);
+    *deltaX = distance * settings->direction.x;
+    *deltaY = distance * settings->direction.y;
 
     /* Move current position */
     /* Take negative of deltaY as 'y' increases going down */
@@ -141,16 +458,18 @@ void move(TurtleSettings* settings, double distance, double* deltaX, double* del
 }
 
 /**
- * Moves the coordinates inside the TurtleSettings struct by a distance calculated
- * by polToRec and draws a line from the old coordinates to the new coordinates.
+ * Moves the coordinates inside the TurtleSettings struct by a distance in the
+ * direction of the current angle and draws a line from the old coordinates to
+ * the new coordinates.
  *
  * Parameters:
  *  settings - the TurtleSettings contain the current settings of the drawing
+ *  canvas   - the Canvas to draw the line on
  *  distance - the magnitude of the polar vector
  *  deltaX   - (export) the distance to move in the 'x' direction
  *  deltaY   - (export) the distance to move in the 'y' direction
  */
-void draw(TurtleSettings* settings, double distance, double* deltaX, double* deltaY)
+void draw(TurtleSettings* settings, Canvas* canvas, double distance, double* deltaX, double* deltaY)
 {
     /* Save old positions to draw from */
     int oldX = (int) roundNum(settings->pos.x);
@@ -161,75 +480,63 @@ void draw(TurtleSettings* settings, double distance, double* deltaX, double* del
 
     /* Adjust the deltas for correct drawing */
     adjustDeltas(deltaX, deltaY);
-    /* Draw line in stdin */
-    line(oldX, oldY, oldX + (int) (*deltaX), oldY + (int) -(*deltaY), &printPattern, &(settings->pattern));
-}
-
-/**
- * Returns true(non-zero) if the command name is "ROTATE", "MOVE", and "DRAW",
- * false(zero) otherwise
- */
-int isCommandWithRealArg(char cmdName[])
-{
-    return strcmp(cmdName, "ROTATE") == 0 ||
-           strcmp(cmdName, "MOVE") == 0 || strcmp(cmdName, "DRAW") == 0;
-}
-
-/**
- * Returns true(non-zero) if the command name is "FG", "BG", false(zero) otherwise
- */
-int isCommandWithIntArg(char cmdName[])
-{
-    return strcmp(cmdName, "FG") == 0 || strcmp(cmdName, "BG") == 0;
-}
-
-/**
- * Returns true(non-zero) if the command name is "PATTERN", false(zero) otherwise
- */
-int isCommandWithCharArg(char cmdName[])
-{
-    return strcmp(cmdName, "PATTERN") == 0;
+    /* Draw line on the canvas */
+    Canvas_drawLine(canvas, oldX, oldY, oldX + (int) (*deltaX), oldY + (int) -(*deltaY));
 }
 
 /**
- * Returns true(non-zero) if the "FG" command's value if between 0 and 15 (inclusive)
- * or if the "BG" command's value is between 0 and 7, false(zero) otherwise.
+ * Returns true(non-zero) if the value of an INT_ARG command is outside the range
+ * in the command table, e.g. the "FG" command's value is not between 0 and 15
+ * (inclusive) or the "BG" command's value is not between 0 and 7, false(zero)
+ * otherwise.
  *
  * Parameters:
- *  cmdName  - the name of the command
- *  cmdValue - the value of the command
+ *  opcode   - the opcode of the command
+ *  num      - the value of the command
+ *  cmdValue - the value of the command as written in the file
+ *  length   - the number of characters in cmdValue
+ *  errors   - the stream to print the error to, or NULL to print nothing
  * Returns:
- *  true(non-zero) if the command value is in a valid range, false(zero) otherwise
+ *  true(non-zero) if the command value is out of the valid range, false(zero)
+ *  otherwise
  */
-int isOutOfBounds(char cmdName[], char cmdValue[])
+int isOutOfBounds(int opcode, int num, char cmdValue[], int length, FILE* errors)
 {
     int isOutOfBounds = FALSE;
-    int num = (int) strtol(cmdValue, NULL, 10);
+    const CommandInfo* info = &(CMD_TABLE[opcode]);
 
-    if (strcmp("FG", cmdName) == 0)
+    if (info->argType == INT_ARG)
     {
-        if (num < MIN_COL_CODE || num > MAX_FG_CODE)
+        if (num < info->minValue || num > info->maxValue)
         {
             isOutOfBounds = TRUE;
-            fprintf(stderr, "ERROR: The %s command requires an integer between"
-                            " %d and %d, not \"%s\".\n",
-                    cmdName, MIN_COL_CODE, MAX_FG_CODE, cmdValue);
-        }
-    }
-    else if (strcmp("BG", cmdName) == 0)
-    {
-        if (num < MIN_COL_CODE || num > MAX_BG_CODE)
-        {
-            isOutOfBounds = TRUE;
-            fprintf(stderr, "ERROR: The %s command requires an integer between"
-                            " %d and %d, not \"%s\".\n",
-                    cmdName, MIN_COL_CODE, MAX_BG_CODE, cmdValue);
+            if (errors != NULL)
+            {
+                fprintf(errors, "ERROR: The %s command requires an integer "
+                                "between %d and %d, not \"%.*s\".\n",
+                        info->name, info->minValue, info->maxValue, length,
+                        cmdValue);
+            }
         }
     }
 
     return isOutOfBounds;
 }
 
+/**
+ * Prints the names of every command in the command table to the stream,
+ * separated by commas, e.g. "ROTATE, MOVE, DRAW".
+ */
+void printCommandNames(FILE* stream)
+{
+    int ii;
+
+    for (ii = 0; ii < NUM_COMMANDS; ii++)
+    {
+        fprintf(stream, ii == 0 ? "%s" : ", %s", CMD_TABLE[ii].name);
+    }
+}
+
 /**
  * Reduce the deltas by one, going towards zero. These will then draw the correct
  * amount of characters.
@@ -259,49 +566,22 @@ void adjustDeltas(double* deltaX, double* deltaY)
 }
 
 /**
- * Keeps the angle setting in the TurtleSettings struct between 0 and 360 as to
- * prevent overflow of the datatype.
+ * Keeps the angle setting in the TurtleSettings struct from 0 up to but not
+ * including 360 as to prevent overflow of the datatype, however far outside
+ * that range the angle is.
  */
 double adjustAngle(double angle)
 {
-    if (angle > 360)
+    angle = fmod(angle, 360.0);
+    if (angle < 0.0)
     {
-        angle -= 360;
+        angle += 360.0;
     }
-    else if (angle < 0)
+    /* Adding 360 to a tiny negative angle can round up to 360 itself */
+    if (angle >= 360.0)
     {
-        angle += 360;
+        angle = 0.0;
     }
 
     return angle;
 }
-
-/**
- * Prints a single character from the PATTERN command's value.
- *
- * Parameters:
- *  pattern - a void pointer pointing to the character to print
- */
-void printPattern(void* pattern)
-{
-    if (pattern != NULL)
-    {
-        printf("%c", *((char*) pattern));
-    }
-}
-
-/**
- * Frees the memory allocated to a Command struct
- *
- * Parameters:
- *  command - the command struct to free
- */
-void freeCommand(void* command)
-{
-    Command* cmd = (Command*) command;
-    free(cmd->value);
-    cmd->value = NULL;
-
-    free(command);
-    command = NULL;
-}
@@ -7,51 +7,82 @@
 #define EFFECTS_H
 #include "effects.h"
 #endif
-#include "linkedList.h"
+#include "canvas.h"
+#include "program.h"
+#include "logWriter.h"
+#include "geometry.h"
+#include "tileRenderer.h"
 #include "utils.h"
 
 #define MAX_CMD_NAME_SIZE 7
 #define MAX_CMD_PARAM_SIZE 10
 
+/* The opcode of each command, which is its index in the command table */
+#define CMD_ROTATE 0
+#define CMD_MOVE 1
+#define CMD_DRAW 2
+#define CMD_FG 3
+#define CMD_BG 4
+#define CMD_PATTERN 5
+#define CMD_REPEAT 6
+#define CMD_END 7
+#define NUM_COMMANDS 8
+#define INVALID_OPCODE -1
+
+/* The type of value each command takes */
+#define REAL_ARG 0
+#define INT_ARG 1
+#define CHAR_ARG 2
+#define NO_ARG 3
+
+/* Most times the body of a REPEAT block can be executed */
+#define MAX_REPEAT_COUNT 1000000000
+
+/**
+ * Defines the functions that execute a command.
+ */
+typedef void (* CommandFunc)(TurtleSettings* settings, Canvas* canvas,
+                             CommandValue* value, LogWriter* log);
+
 /**
- * A struct to store a Command. The struct contains the name (char array) of the
- * command and a void pointer to the value of the command. A void pointer is used
- * as the value could either be a double, int, or char.
+ * A struct describing a command: its name, the type of value it takes, the valid
+ * range of an integer value, and the function which executes it. REPEAT and
+ * END have no function, as they only change which command is executed next.
  */
 typedef struct
 {
-    struct
-    {
-        char value[MAX_CMD_NAME_SIZE];
-        size_t length;
-    } name;
-    void* value;
-} Command;
+    const char* name;
+    int argType;
+    int minValue;
+    int maxValue;
+    CommandFunc execute;
+} CommandInfo;
 
-Command* createCommand(char name[], size_t len, void* value);
+int getOpcode(char cmdName[]);
 
-void executeCommand(TurtleSettings* settings, Command* command, FILE* logFile);
+const CommandInfo* getCommandInfo(int opcode);
 
-void rotate(TurtleSettings* settings, double angle);
+void executeCommand(TurtleSettings* settings, Canvas* canvas, int opcode,
+                    CommandValue* value, LogWriter* log);
 
-void move(TurtleSettings* settings, double distance, double* deltaX, double* deltaY);
+int executeProgram(TurtleSettings* settings, Canvas* canvas, Program* program,
+                   ProgramCounter* counter, Geometry* geometry,
+                   TileRenderer* renderer, LogWriter* log);
 
-void draw(TurtleSettings* settings, double distance, double* deltaX, double* deltaY);
+int checkRepeats(Program* program, int* numValid, FILE* errors);
 
-int isCommandWithRealArg(char cmdName[]);
+void rotate(TurtleSettings* settings, double angle);
+
+void move(TurtleSettings* settings, double distance, double* deltaX, double* deltaY);
 
-int isCommandWithIntArg(char cmdName[]);
+void draw(TurtleSettings* settings, Canvas* canvas, double distance, double* deltaX, double* deltaY);
 
-int isCommandWithCharArg(char cmdName[]);
+int isOutOfBounds(int opcode, int num, char cmdValue[], int length, FILE* errors);
 
-int isOutOfBounds(char cmdName[], char cmdValue[]);
+void printCommandNames(FILE* stream);
 
 double adjustAngle(double angle);
 
 void adjustDeltas(double* deltaX, double* deltaY);
 
-void printPattern(void* pattern);
-
-void freeCommand(void* command);
-
 #endif
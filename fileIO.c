@@ -1,156 +1,504 @@
+/* pthreads are POSIX, not C89 */
+#define _POSIX_C_SOURCE 200112L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <pthread.h>
 #include "fileIO.h"
 
-#define MAX_LINE_SIZE 50
+/* Fewest bytes of a file worth giving to a thread of their own */
+#define MIN_CHUNK_SIZE 262144
+
+/**
+ * A struct representing a chunk of a file read by one thread: the whole lines
+ * from start up to end, the Program their commands are appended to, and the
+ * first invalid line, if there is one. Errors are only printed when 'errors'
+ * is not NULL.
+ */
+typedef struct
+{
+    char* start;
+    char* end;
+    Program* program;
+    FILE* errors;
+    int isEmpty;
+    int errNo;
+    char* errorLine;
+    int errorLength;
+    pthread_t thread;
+    int isThreaded;
+} Chunk;
+
+static int readBlock(char* block, size_t length, Program* program,
+                     int numThreads, int* isEmpty, FILE* errors);
+
+static void* readChunk(void* data);
+
+static int parseLine(Program* program, char* line, int length, int* isEmpty,
+                     FILE* errors);
+
+static int nextToken(char** pos, char* end, char** token, int* length);
+
+static int parseValue(int opcode, char* cmdName, int nameLength, char* cmdValue,
+                      int valueLength, CommandValue* value, FILE* errors);
 
 /**
- * Reads an input file and verifies that each line is valid. If a line is
- * invalid the file stops being read and the function returns an error number.
+ * Reads an input file a single time, validating each line and converting it into
+ * a command which is appended to a Program. If a line is invalid the file stops
+ * being read, the partially built Program is freed and the function returns an
+ * error number. Large regular files are split into chunks which are read by
+ * several threads at once, with the same result and the same error message.
+ * Whether every REPEAT is closed by an END is checked once the whole file has
+ * been read. Error messages are printed to 'errors'.
  *
  * Parameters:
- *   fileName - the name of the file to validate
+ *   fileName   - the name of the file to read the Commands from
+ *   program    - (export) the Program of commands, or NULL on error
+ *   numThreads - the most threads to read with, or zero for one per processor
+ *   errors     - the stream to print error messages to
  * Returns:
  *   0 - on success
  *   1 - if the file could not be opened
  *   2 - if the file could not be closed
  *   3 - if their is a system error while reading the file
  *   4 - if the file is empty
- *   5 - if the number of parameters on all lines does not equal two
+ *   5 - if a line does not have one parameter for its command, or none for END
  *   6 - if the specified command does not exit
  *   7 - if the data type does not match the one required by the command
  *   8 - if the data type is out of the valid range
+ *  10 - if a REPEAT and END do not match, or a REPEAT block has no commands
+ *       to execute
+ * Other parts of the program also use:
+ *   9 - if a compiled program file is not valid, damaged or out of date
+ *  11 - if a request to the server does not name a format, is too large or
+ *       is not sent in time
+ *  12 - if the drawing would execute more commands than it is allowed to
  */
-int validateInputFile(char* fileName)
+int readCommandsFromFile(char* fileName, Program** program, int numThreads,
+                         FILE* errors)
+{
+    int errNo;
+    LineReader* reader;
+
+    errNo = 0;
+    (*program) = NULL;
+
+    reader = NULL;
+    reader = LineReader_open(fileName);
+    if (reader != NULL)
+    {
+        errNo = readCommandsFromReader(reader, program, numThreads, errors);
+        if (LineReader_close(reader) != 0)
+        {
+            errNo = 2; /* Error closing file */
+            printSystemError(errors, "ERROR: The file was not closed successfully");
+            Program_free(*program);
+            (*program) = NULL;
+        }
+    }
+    else
+    {
+        errNo = 1; /* File could not be opened */
+        printSystemError(errors, "ERROR: The file could not be opened");
+    }
+
+    return errNo;
+}
+
+/**
+ * Validates every line left in a LineReader and reads them into a Program in
+ * the same way as readCommandsFromFile, which opens and closes the file around
+ * it.
+ *
+ * Parameters:
+ *   reader     - the LineReader to read the lines from
+ *   program    - (export) the Program of commands, or NULL on error
+ *   numThreads - the most threads to read with, or zero for one per processor
+ *   errors     - the stream to print error messages to
+ * Returns:
+ *   the same error codes as readCommandsFromFile, except 1 and 2
+ */
+int readCommandsFromReader(LineReader* reader, Program** program, int numThreads,
+                           FILE* errors)
 {
     int errNo;
-    FILE* cmdFile;
-    char line[MAX_LINE_SIZE + 1];
     int isEmpty;
+    char* block;
+    size_t blockLength;
+    int numValid;
 
     errNo = 0;
+    (*program) = Program_create();
+    if ((*program) == NULL)
+    {
+        errNo = 3; /* System error */
+        fprintf(errors, "ERROR: Could not allocate memory for the commands.\n");
+    }
+    /* isEmpty is set to FALSE when a line inside the file is not empty */
+    isEmpty = TRUE;
+    if (errNo == 0 && LineReader_nextBlock(reader, &block, &blockLength))
+    {
+        errNo = readBlock(block, blockLength, *program, numThreads, &isEmpty,
+                          errors);
+    }
+    while (errNo == 0 && !LineReader_isAtEnd(reader))
+    {
+        errNo = readCommands(reader, *program, INT_MAX, &isEmpty, errors);
+    }
+    if (isEmpty && errNo == 0)
+    {
+        errNo = 4; /* Input file is empty */
+        fprintf(errors, "ERROR: The input file is empty.\n");
+    }
+    if (errNo == 0)
+    {
+        errNo = checkRepeats(*program, &numValid, errors);
+    }
+    if (errNo != 0)
+    {
+        /* Discard the commands read before the error */
+        Program_free(*program);
+        (*program) = NULL;
+    }
 
-    cmdFile = NULL;
-    cmdFile = fopen(fileName, "r");
-    if (cmdFile != NULL)
+    return errNo;
+}
+
+/**
+ * A private function that splits a block of whole lines into chunks of about
+ * the same size, reads each chunk in a thread of its own into a Program of its
+ * own, then appends the Programs in order. The threads do not print errors.
+ * Instead the first invalid line in the file is read again afterwards, which
+ * prints exactly what reading the lines in order would have. A block too small
+ * to split is read by the calling thread alone.
+ *
+ * Parameters:
+ *  block      - the lines, each ending in '\n'
+ *  length     - the number of characters in the block
+ *  program    - the Program to append the commands to
+ *  numThreads - the most threads to read with, or zero for one per processor
+ *  isEmpty    - (export) set to false(zero) when a line is not empty
+ *  errors     - the stream to print error messages to
+ * Returns:
+ *  the same error codes as readCommands
+ */
+static int readBlock(char* block, size_t length, Program* program,
+                     int numThreads, int* isEmpty, FILE* errors)
+{
+    Chunk chunks[MAX_THREADS];
+    int ii, numChunks;
+    char* split;
+    int errNo = 0;
+
+    numChunks = getNumThreads(numThreads);
+    if ((size_t) numChunks > length / MIN_CHUNK_SIZE)
+    {
+        numChunks = (int) (length / MIN_CHUNK_SIZE);
+    }
+    if (numChunks < 1)
+    {
+        numChunks = 1;
+    }
+
+    for (ii = 0; ii < numChunks; ii++)
+    {
+        /* Each chunk ends at the first newline after its share of the block */
+        chunks[ii].start = ii == 0 ? block : chunks[ii - 1].end;
+        chunks[ii].end = block + length;
+        split = block + length / numChunks * (ii + 1) - 1;
+        if (ii < numChunks - 1 && split >= chunks[ii].start)
+        {
+            chunks[ii].end = (char*) memchr(split, '\n', block + length - split) + 1;
+        }
+        else if (ii < numChunks - 1)
+        {
+            chunks[ii].end = chunks[ii].start;
+        }
+        chunks[ii].program = ii == 0 ? program : Program_create();
+        chunks[ii].errors = numChunks == 1 ? errors : NULL;
+        chunks[ii].isEmpty = TRUE;
+        chunks[ii].errNo = 0;
+        chunks[ii].errorLine = NULL;
+        chunks[ii].errorLength = 0;
+        chunks[ii].isThreaded = FALSE;
+        if (chunks[ii].program == NULL)
+        {
+            errNo = 3; /* System error */
+        }
+    }
+
+    if (errNo == 0)
     {
-        /* isEmpty is set to FALSE when a line inside the file is not empty */
-        isEmpty = TRUE;
-        /* Fetch each line */
-        while (fgets(line, MAX_LINE_SIZE + 1, cmdFile) != NULL && errNo == 0)
+        for (ii = 1; ii < numChunks; ii++)
         {
-            if (!ferror(cmdFile))
+            chunks[ii].isThreaded = pthread_create(&chunks[ii].thread, NULL,
+                                                   &readChunk, &chunks[ii]) == 0;
+        }
+        readChunk(&chunks[0]);
+        for (ii = 1; ii < numChunks; ii++)
+        {
+            if (chunks[ii].isThreaded)
             {
-                /* Returns zero on success */
-                errNo = validateLine(line, &isEmpty);
+                pthread_join(chunks[ii].thread, NULL);
             }
             else
             {
-                errNo = 3; /* IO Error */
-                perror("ERROR: An IO error occurred while reading from the file");
+                readChunk(&chunks[ii]);
             }
         }
-        if (isEmpty)
+
+        /* Join the chunks in order, stopping at the first invalid line */
+        for (ii = 0; ii < numChunks && errNo == 0; ii++)
         {
-            errNo = 4; /* Input file is empty */
-            fprintf(stderr, "ERROR: The input file is empty.\n");
+            if (!chunks[ii].isEmpty)
+            {
+                (*isEmpty) = FALSE;
+            }
+            if (ii > 0 && !Program_appendProgram(program, chunks[ii].program))
+            {
+                errNo = 3; /* System error */
+            }
+            else if (chunks[ii].errNo != 0 && chunks[ii].errors == NULL)
+            {
+                errNo = parseLine(program, chunks[ii].errorLine,
+                                  chunks[ii].errorLength, isEmpty, errors);
+                if (errNo == 0)
+                {
+                    /* Memory only ran out in the chunk's thread */
+                    errNo = chunks[ii].errNo;
+                }
+            }
+            else
+            {
+                errNo = chunks[ii].errNo;
+            }
         }
-        if (fclose(cmdFile) != 0)
+    }
+    if (errNo == 3)
+    {
+        fprintf(errors, "ERROR: Could not allocate memory for the commands.\n");
+    }
+
+    for (ii = 1; ii < numChunks; ii++)
+    {
+        Program_free(chunks[ii].program);
+    }
+
+    return errNo;
+}
+
+/**
+ * A private function that reads the lines of a chunk into its Program, stopping
+ * at the first invalid line. Matches the start routine required by
+ * pthread_create().
+ *
+ * Parameters:
+ *  data - a void pointer to the Chunk to read
+ */
+static void* readChunk(void* data)
+{
+    Chunk* chunk = (Chunk*) data;
+    char* line = chunk->start;
+    char* newLine;
+
+    while (line < chunk->end && chunk->errNo == 0)
+    {
+        newLine = (char*) memchr(line, '\n', chunk->end - line);
+        chunk->errNo = parseLine(chunk->program, line, (int) (newLine - line),
+                                 &(chunk->isEmpty), chunk->errors);
+        if (chunk->errNo != 0)
         {
-            errNo = 2; /* Error closing file */
-            perror("ERROR: The file was not closed successfully");
+            chunk->errorLine = line;
+            chunk->errorLength = (int) (newLine - line);
         }
+        line = newLine + 1;
     }
-    else
+
+    return NULL;
+}
+
+/**
+ * Reads lines from a LineReader, validating each one and appending its command
+ * to the Program, until the Program holds maxCommands commands, the end of the
+ * file is reached, or the next line has not arrived yet and this call has
+ * already appended commands to execute. A REPEAT block opened by this call is
+ * always read up to its END first, however long it is, so the block can be
+ * executed. Reading stops at the first invalid line. This lets a small Program
+ * be used as a bounded buffer that is refilled from a stream.
+ *
+ * Parameters:
+ *  reader      - the LineReader to read the lines from
+ *  program     - the Program to append the commands to
+ *  maxCommands - the number of commands the Program should hold when done
+ *  isEmpty     - (export) set to false(zero) when a line is not empty
+ *  errors      - the stream to print error messages to
+ * Returns:
+ *   0 - on success
+ *   3 - if their is a system error while reading the file
+ *   5 - if a line does not have one parameter for its command, or none for END
+ *   6 - if the specified command does not exit
+ *   7 - if the data type does not match the one required by the command
+ *   8 - if the data type is out of the valid range
+ */
+int readCommands(LineReader* reader, Program* program, int maxCommands, int* isEmpty,
+                 FILE* errors)
+{
+    int errNo;
+    char* line;
+    int length;
+    int firstCommand;
+    int depth, opcode;
+
+    errNo = 0;
+    firstCommand = program->size;
+    depth = 0;
+    /* Fetch each line */
+    while (errNo == 0 && (program->size < maxCommands || depth > 0) &&
+           (program->size == firstCommand || depth > 0 ||
+            LineReader_hasLine(reader)) &&
+           LineReader_next(reader, &line, &length))
     {
-        errNo = 1; /* File could not be opened */
-        perror("ERROR: The file could not be opened");
+        /* Returns zero on success */
+        errNo = parseLine(program, line, length, isEmpty, errors);
+        if (errNo == 0 && program->size > firstCommand)
+        {
+            /* Keep reading until the REPEAT blocks opened here are closed */
+            opcode = program->opcodes[program->size - 1];
+            if (opcode == CMD_REPEAT)
+            {
+                depth++;
+            }
+            else if (opcode == CMD_END)
+            {
+                depth--;
+            }
+        }
+    }
+    if (reader->isError)
+    {
+        errNo = 3; /* IO Error */
+        printSystemError(errors, "ERROR: An IO error occurred while reading from "
+                                 "the file");
     }
 
     return errNo;
 }
 
 /**
- * Validates a Command from a line retrieved from the input file. Returns an error
- * code when the line is invalid.
+ * Validates a command from a line retrieved from the input file and, if it is
+ * valid, converts its name to an opcode and appends it to the end of the
+ * Program. The command table decides how the value is validated. Returns an
+ * error code when the line is invalid. The line is not copied or modified, and
+ * it does not need to end in '\0'.
  *
  * Parameters:
- *  line    - the line to validate
+ *  program - the Program to append the commands to
+ *  line    - the line to validate and convert
+ *  length  - the number of characters in the line
  *  isEmpty - (export) whether or not the line is empty
  * Returns:
- *   5 - if the number of parameters on all lines does not equal two
+ *   5 - if a line does not have one parameter for its command, or none for END
  *   6 - if the specified command does not exit
  *   7 - if the data type does not match the one required by the command
  *   8 - if the data type is out of the valid range
+ *   3 - if there is not enough memory to store the command
  */
-int validateLine(char line[], int* isEmpty)
+int processLine(Program* program, char* line, int length, int* isEmpty)
+{
+    return parseLine(program, line, length, isEmpty, stderr);
+}
+
+/**
+ * A private function that does the work of processLine, printing the error
+ * message for an invalid line to 'errors', or nothing if it is NULL.
+ */
+static int parseLine(Program* program, char* line, int length, int* isEmpty,
+                     FILE* errors)
 {
     int errNo;
-    char cmdName[MAX_CMD_NAME_SIZE + 1], cmdNameUC[MAX_CMD_NAME_SIZE + 1];
-    char cmdValue[MAX_CMD_PARAM_SIZE + 1], cmdParamTemp[MAX_CMD_PARAM_SIZE + 1];
-    int numParams;
+    char* pos;
+    char* cmdName;
+    char* cmdValue;
+    char* cmdParamTemp;
+    int nameLength, valueLength, tempLength;
+    char cmdNameUC[MAX_CMD_NAME_SIZE + 1];
+    int opcode;
+    CommandValue value;
+    int hasName, hasValue, hasMore;
 
     errNo = 0;
 
-    removeNewLineChar(line);
     /* If the line is not empty */
-    if (strcmp(line, "") != 0)
+    if (length > 0)
     {
         (*isEmpty) = FALSE;
+        pos = line;
         /* cmdParamTemp is used to test if there is more than two params */
-        numParams = sscanf(line, " %10s %50s %50s ", cmdName, cmdValue, cmdParamTemp);
-        if (numParams == 2)
+        hasName = nextToken(&pos, line + length, &cmdName, &nameLength);
+        hasValue = hasName && nextToken(&pos, line + length, &cmdValue, &valueLength);
+        hasMore = hasValue && nextToken(&pos, line + length, &cmdParamTemp, &tempLength);
+
+        opcode = INVALID_OPCODE;
+        /* No command has a longer name */
+        if (hasName && !hasMore && nameLength <= MAX_CMD_NAME_SIZE)
         {
-            strncpy(cmdNameUC, cmdName, MAX_CMD_NAME_SIZE + 1);
+            memcpy(cmdNameUC, cmdName, nameLength);
+            cmdNameUC[nameLength] = '\0';
+            /* Convert the name to uppercase for easier comparison */
             convertToUpperCase(cmdNameUC);
-            /* If the command is ROTATE, DRAW or MOVE */
-            if (isCommandWithRealArg(cmdNameUC))
+            opcode = getOpcode(cmdNameUC);
+        }
+
+        /* Every command takes one value apart from END, which takes none. An
+         * unknown command is only reported as one when it has a value */
+        if (hasName && !hasMore &&
+            hasValue == (opcode == INVALID_OPCODE ||
+                         getCommandInfo(opcode)->argType != NO_ARG))
+        {
+            if (opcode != INVALID_OPCODE && hasValue)
             {
-                if (!isReal(cmdValue))
-                {
-                    errNo = 7; /* Not the required data type */
-                    fprintf(stderr, "ERROR: The %s command requires a double or "
-                                    "float, not \"%s\".\n", cmdName, cmdValue);
-                }
+                errNo = parseValue(opcode, cmdName, nameLength, cmdValue,
+                                   valueLength, &value, errors);
             }
-            /* If the command is FG or BG */
-            else if (isCommandWithIntArg(cmdNameUC))
+            else if (opcode != INVALID_OPCODE)
             {
-                if (!isInteger(cmdValue))
-                {
-                    errNo = 7; /* Not the required data type */
-                    fprintf(stderr, "ERROR: The %s command requires an integer, "
-                                    "not \"%s\".\n", cmdName, cmdValue);
-                }
-                else if (isOutOfBounds(cmdNameUC, cmdValue))
-                {
-                    errNo = 8; /* Integer is out of the valid range */
-                }
+                value.integer = 0;
             }
-            /* If the command is PATTERN */
-            else if (isCommandWithCharArg(cmdNameUC))
+            else
             {
-                if (!isCharacter(cmdValue))
+                errNo = 6; /* Invalid command name */
+                if (errors != NULL)
                 {
-                    errNo = 7; /* Not the required data type */
-                    fprintf(stderr, "ERROR: The PATTERN command requires a single"
-                                    " character, not \"%s\".\n", cmdValue);
+                    fprintf(errors, "ERROR: The \"%.*s\" command does not exist.\n",
+                            nameLength, cmdName);
+                    fprintf(errors, "Use one or more of the following commands "
+                                    "instead: ");
+                    printCommandNames(errors);
+                    fprintf(errors, ".\n");
                 }
             }
-            else
+
+            if (errNo == 0 && !Program_append(program, opcode, value))
             {
-                errNo = 6; /* Invalid command name */
-                fprintf(stderr, "ERROR: The \"%s\" command does not exist.\n", cmdName);
-                fprintf(stderr, "Use one or more of the following commands instead:"
-                                " ROTATE, MOVE, DRAW, FG, BG, PATTERN.\n");
+                errNo = 3; /* System error */
+                if (errors != NULL)
+                {
+                    fprintf(errors, "ERROR: Could not allocate memory for "
+                                    "the commands.\n");
+                }
             }
         }
         else
         {
             errNo = 5; /* Incorrect number of params */
-            fprintf(stderr, "ERROR: The line \"%s\" has an incorrect number of "
-                            "parameters.\n", line);
+            if (errors != NULL)
+            {
+                fprintf(errors, "ERROR: The line \"%.*s\" has an incorrect "
+                                "number of parameters.\n", length, line);
+            }
         }
     }
 
@@ -158,92 +506,107 @@ int validateLine(char line[], int* isEmpty)
 }
 
 /**
- * Opens a file with the specified file name and reads each line into a Command
- * struct which is inserted into a Linked List that is then returned.
+ * Finds the next whitespace separated token in a line without copying it.
  *
  * Parameters:
- *  fileName - the name of the file to read the Commands from
+ *  pos    - (export) where to start looking, moved to just after the token
+ *  end    - the end of the line
+ *  token  - (export) a pointer to the start of the token
+ *  length - (export) the number of characters in the token
  * Returns:
- *  cmdList - the Linked List of Command structs
+ *  true(non-zero) if a token was found, false(zero) otherwise
  */
-LinkedList* readCommandsFromFile(char* fileName)
+static int nextToken(char** pos, char* end, char** token, int* length)
 {
-    FILE* cmdFile;
-    LinkedList* cmdList;
-    char line[MAX_LINE_SIZE + 1];
-
-    cmdList = NULL;
-    cmdFile = NULL;
-    cmdFile = fopen(fileName, "r");
-    if (cmdFile != NULL)
+    while (*pos < end && isspace((unsigned char) **pos))
     {
-        cmdList = LinkedList_create();
-        /* Fetch each line in the file */
-        while (fgets(line, MAX_LINE_SIZE + 1, cmdFile) != NULL)
-        {
-            if (!ferror(cmdFile))
-            {
-                /* Convert each line to a Command struct and insert it into the list */
-                processLine(cmdList, line);
-            }
-            else
-            {
-                perror("ERROR: An IO error occurred while reading from the file");
-            }
-        }
-
-        if (fclose(cmdFile) != 0)
-        {
-            perror("ERROR: The file was not closed successfully");
-        }
+        (*pos)++;
     }
-    else
+    *token = *pos;
+    while (*pos < end && !isspace((unsigned char) **pos))
     {
-        perror("ERROR: The file could not be opened");
+        (*pos)++;
     }
+    *length = (int) (*pos - *token);
 
-    return cmdList;
+    return *length > 0;
 }
 
 /**
- * Converts a valid line containing a command into a Command struct which is then
- * inserted into the end of the Linked List.
+ * Validates the value of a command against the type and range in the command
+ * table and converts it into a CommandValue. Returns an error code when the
+ * value is invalid.
  *
  * Parameters:
- *  cmdList - the Linked List to insert the commands into
- *  line    - the character array to read the command from
+ *  opcode      - the opcode of the command
+ *  cmdName     - the name of the command as written in the file
+ *  nameLength  - the number of characters in the name
+ *  cmdValue    - the value of the command as written in the file
+ *  valueLength - the number of characters in the value
+ *  value       - (export) the converted value
+ *  errors      - the FILE pointer to print an error to, or NULL for none
+ * Returns:
+ *   0 - on success
+ *   7 - if the data type does not match the one required by the command
+ *   8 - if the data type is out of the valid range
  */
-void processLine(LinkedList* cmdList, char line[])
+static int parseValue(int opcode, char* cmdName, int nameLength, char* cmdValue,
+                      int valueLength, CommandValue* value, FILE* errors)
 {
-    char cmdName[MAX_CMD_NAME_SIZE + 1], cmdValue[MAX_CMD_PARAM_SIZE + 1];
-    int cmdValueInt;
-    char cmdValueChar;
-    double cmdValueReal;
+    int errNo = 0;
+    const CommandInfo* info = getCommandInfo(opcode);
 
-    /* if the line is not empty */
-    if (strcmp(line, "\n") != 0)
+    /* If the command is ROTATE, DRAW or MOVE */
+    if (info->argType == REAL_ARG)
     {
-        /* Retrieve the name of the command and its value */
-        sscanf(line, " %50s %50s ", cmdName, cmdValue);
-        /* Convert the name to uppercase for easier comparison */
-        convertToUpperCase(cmdName);
-        /* If the command is ROTATE, DRAW or MOVE */
-        if (isCommandWithRealArg(cmdName))
+        if (!isReal(cmdValue, valueLength, &(value->real)))
         {
-            cmdValueReal = strtod(cmdValue, NULL);
-            LinkedList_insertLast(cmdList, createCommand(cmdName, MAX_CMD_NAME_SIZE + 1, &cmdValueReal));
+            errNo = 7; /* Not the required data type */
+            if (errors != NULL)
+            {
+                fprintf(errors, "ERROR: The %.*s command requires a double or "
+                                "float, not \"%.*s\".\n",
+                        nameLength, cmdName, valueLength, cmdValue);
+            }
         }
-        /* If the command is FG, or BG */
-        else if (isCommandWithIntArg(cmdName))
+    }
+    /* If the command is FG or BG */
+    else if (info->argType == INT_ARG)
+    {
+        if (!isInteger(cmdValue, valueLength, &(value->integer)))
         {
-            cmdValueInt = (int) strtol(cmdValue, NULL, 10);
-            LinkedList_insertLast(cmdList, createCommand(cmdName, MAX_CMD_NAME_SIZE + 1, &cmdValueInt));
+            errNo = 7; /* Not the required data type */
+            if (errors != NULL)
+            {
+                fprintf(errors, "ERROR: The %.*s command requires an integer, "
+                                "not \"%.*s\".\n",
+                        nameLength, cmdName, valueLength, cmdValue);
+            }
         }
-        /* If the command is PATTERN */
-        else if (isCommandWithCharArg(cmdName))
+        else if (isOutOfBounds(opcode, value->integer, cmdValue, valueLength,
+                               errors))
         {
-            cmdValueChar = cmdValue[0];
-            LinkedList_insertLast(cmdList, createCommand(cmdName, MAX_CMD_NAME_SIZE + 1, &cmdValueChar));
+            errNo = 8; /* Integer is out of the valid range */
         }
     }
+    /* If the command is PATTERN */
+    else if (info->argType == CHAR_ARG)
+    {
+        if (!isCharacter(cmdValue, valueLength))
+        {
+            errNo = 7; /* Not the required data type */
+            if (errors != NULL)
+            {
+                fprintf(errors, "ERROR: The %s command requires a single"
+                                " character, not \"%.*s\".\n",
+                        info->name, valueLength, cmdValue);
+            }
+        }
+        else
+        {
+            value->character = cmdValue[0];
+        }
+    }
+
+    return errNo;
 }
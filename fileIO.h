@@ -3,15 +3,19 @@
 
 #include "boolean.h"
 #include "command.h"
-#include "linkedList.h"
+#include "program.h"
+#include "lineReader.h"
 #include "utils.h"
 
-int validateInputFile(char* fileName);
+int readCommandsFromFile(char* fileName, Program** program, int numThreads,
+                         FILE* errors);
 
-int validateLine(char line[], int* isEmpty);
+int readCommandsFromReader(LineReader* reader, Program** program, int numThreads,
+                           FILE* errors);
 
-LinkedList* readCommandsFromFile(char* fileName);
+int readCommands(LineReader* reader, Program* program, int maxCommands, int* isEmpty,
+                 FILE* errors);
 
-void processLine(LinkedList* cmdList, char* line);
+int processLine(Program* program, char* line, int length, int* isEmpty);
 
 #endif
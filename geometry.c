@@ -0,0 +1,214 @@
+/**
+ * Implementation of the geometry pass, which works out where the turtle is
+ * after every ROTATE, MOVE and DRAW of a batch before anything is drawn. The
+ * heading and the position are running sums over the commands, so they are
+ * added up in one tight loop over the program's arrays, apart from the canvas
+ * and the log. REPEAT blocks are executed in the same loop with a counter for
+ * each block, jumping back to the start of the body, so they are never
+ * expanded.
+ */
+
+#include <stdlib.h>
+#include "boolean.h"
+#include "geometry.h"
+#include "command.h"
+
+static int findEnd(Program* program, ProgramCounter* counter, int repeat);
+
+/**
+ * Allocates enough memory for a Geometry and returns it. Its arrays are only
+ * filled in by Geometry_compute().
+ *
+ * Returns:
+ *  geometry - a Geometry, or NULL if the memory could not be allocated
+ */
+Geometry* Geometry_create()
+{
+    return (Geometry*) malloc(sizeof(Geometry));
+}
+
+/**
+ * Starts a ProgramCounter at the first command of a Program, outside any REPEAT
+ * block, forgetting the ENDs of the blocks it skipped. numExecuted and numLeft
+ * are left as they are.
+ *
+ * Parameters:
+ *  counter - the ProgramCounter to reset
+ */
+void ProgramCounter_reset(ProgramCounter* counter)
+{
+    int ii;
+
+    counter->next = 0;
+    counter->depth = 0;
+    for (ii = 0; ii < SKIP_CACHE_SIZE; ii++)
+    {
+        counter->skipRepeat[ii] = -1;
+    }
+}
+
+/**
+ * Works out the positions of the turtle over a batch of commands and the cells
+ * each DRAW's line ends at, in the same way as rotate(), move() and draw() so
+ * the results are exactly the same. The commands are taken from where the
+ * ProgramCounter is, following REPEAT blocks, until the batch is full, the
+ * Program ends or the ProgramCounter has no commands left to execute. The pass
+ * stops before a command when the turtle is off the top or left of the
+ * terminal, as no more of the program is executed. The settings and the
+ * ProgramCounter are left as they are after the last command passed. The
+ * Program's REPEAT blocks must have been checked with checkRepeats().
+ *
+ * Parameters:
+ *  geometry - (export) the Geometry to fill in
+ *  settings - the TurtleSettings at the start of the batch
+ *  program  - the Program holding the commands
+ *  counter  - the ProgramCounter of the next command
+ * Returns:
+ *  the number of commands in the batch, which is less than GEOMETRY_BATCH_SIZE
+ *  if the Program ended, the turtle went out of bounds or no commands were
+ *  left
+ */
+int Geometry_compute(Geometry* geometry, TurtleSettings* settings,
+                     Program* program, ProgramCounter* counter)
+{
+    int ii = 0;
+    int next, depth, opcode;
+    long numLeft;
+    double x, y, angle, directionX, directionY;
+    double deltaX, deltaY;
+    const unsigned char* opcodes = program->opcodes;
+    const CommandValue* values = program->values;
+
+    next = counter->next;
+    depth = counter->depth;
+    numLeft = counter->numLeft;
+    x = settings->pos.x;
+    y = settings->pos.y;
+    angle = settings->angle;
+    directionX = settings->direction.x;
+    directionY = settings->direction.y;
+
+    geometry->x[0] = x;
+    geometry->y[0] = y;
+    while (ii < GEOMETRY_BATCH_SIZE && next < program->size && numLeft != 0 &&
+           isPositionValid(settings, x, y))
+    {
+        opcode = opcodes[next];
+        if (numLeft > 0)
+        {
+            numLeft--;
+        }
+        if (counter->numExecuted != NULL)
+        {
+            counter->numExecuted[opcode]++;
+        }
+
+        if (opcode == CMD_REPEAT)
+        {
+            if (values[next].integer > 0)
+            {
+                counter->bodyStart[depth] = next + 1;
+                counter->remaining[depth] = values[next].integer;
+                depth++;
+                next++;
+            }
+            else
+            {
+                next = findEnd(program, counter, next) + 1;
+            }
+        }
+        else if (opcode == CMD_END)
+        {
+            counter->remaining[depth - 1]--;
+            if (counter->remaining[depth - 1] > 0)
+            {
+                next = counter->bodyStart[depth - 1];
+            }
+            else
+            {
+                depth--;
+                next++;
+            }
+        }
+        else
+        {
+            geometry->index[ii] = next;
+            if (opcode == CMD_ROTATE)
+            {
+                angle = adjustAngle(angle + values[next].real);
+                unitVector(angle, &directionX, &directionY);
+            }
+            else if (opcode == CMD_MOVE || opcode == CMD_DRAW)
+            {
+                deltaX = values[next].real * directionX;
+                deltaY = values[next].real * directionY;
+                x += deltaX;
+                /* Take negative of deltaY as 'y' increases going down */
+                y += -deltaY;
+                if (opcode == CMD_DRAW)
+                {
+                    adjustDeltas(&deltaX, &deltaY);
+                    geometry->endX[ii] = (int) roundNum(geometry->x[ii]) + (int) deltaX;
+                    geometry->endY[ii] = (int) roundNum(geometry->y[ii]) + (int) -deltaY;
+                }
+            }
+            ii++;
+            next++;
+            geometry->x[ii] = x;
+            geometry->y[ii] = y;
+        }
+    }
+
+    counter->next = next;
+    counter->depth = depth;
+    counter->numLeft = numLeft;
+    settings->pos.x = x;
+    settings->pos.y = y;
+    settings->angle = angle;
+    settings->direction.x = directionX;
+    settings->direction.y = directionY;
+
+    return ii;
+}
+
+/**
+ * A private function that finds the END which closes a REPEAT block, searching
+ * the Program only when the ProgramCounter has not remembered it.
+ *
+ * Parameters:
+ *  program - the Program holding the block
+ *  counter - the ProgramCounter to remember the END in
+ *  repeat  - the index of the block's REPEAT
+ * Returns:
+ *  the index of the block's END
+ */
+static int findEnd(Program* program, ProgramCounter* counter, int repeat)
+{
+    int slot = repeat % SKIP_CACHE_SIZE;
+    int next = repeat + 1;
+    int depth = 1;
+
+    if (counter->skipRepeat[slot] == repeat)
+    {
+        next = counter->skipEnd[slot] + 1;
+    }
+    else
+    {
+        while (depth > 0)
+        {
+            if (program->opcodes[next] == CMD_REPEAT)
+            {
+                depth++;
+            }
+            else if (program->opcodes[next] == CMD_END)
+            {
+                depth--;
+            }
+            next++;
+        }
+        counter->skipRepeat[slot] = repeat;
+        counter->skipEnd[slot] = next - 1;
+    }
+
+    return next - 1;
+}
@@ -0,0 +1,64 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include "settings.h"
+#include "program.h"
+
+/* Number of commands whose geometry is worked out in one pass */
+#define GEOMETRY_BATCH_SIZE 4096
+
+/* Deepest that REPEAT blocks can be nested */
+#define MAX_REPEAT_DEPTH 64
+
+/* Number of REPEAT blocks executed zero times whose END is remembered */
+#define SKIP_CACHE_SIZE 64
+
+/**
+ * A struct representing how far execution of a Program has got: the index of
+ * the next command, and for each REPEAT block being executed, from the
+ * outermost, the index of the first command of its body and the number of
+ * times the body is still to be executed, including the current one. The END
+ * of a block executed zero times is remembered in the slot of its REPEAT's
+ * index modulo SKIP_CACHE_SIZE, so a block inside another is not searched for
+ * its END every time it is skipped. When numExecuted is not NULL it counts how
+ * many times each opcode was executed. numLeft is the number of commands,
+ * counting every REPEAT and END, that may still be executed, or -1 for no limit.
+ */
+typedef struct
+{
+    int next;
+    int depth;
+    int bodyStart[MAX_REPEAT_DEPTH];
+    int remaining[MAX_REPEAT_DEPTH];
+    int skipRepeat[SKIP_CACHE_SIZE];
+    int skipEnd[SKIP_CACHE_SIZE];
+    long* numExecuted;
+    long numLeft;
+} ProgramCounter;
+
+/**
+ * A struct which holds the geometry of a batch of commands as contiguous
+ * arrays, worked out before anything is drawn. index holds the index in the
+ * Program of each command executed, in the order they were executed, which
+ * repeats the body of a REPEAT block and leaves out REPEAT and END. x and y
+ * hold the position of the turtle before each command, and after the last one.
+ * endX and endY hold the cell a DRAW command's line ends at, and are unused for
+ * other commands.
+ */
+typedef struct
+{
+    int index[GEOMETRY_BATCH_SIZE];
+    double x[GEOMETRY_BATCH_SIZE + 1];
+    double y[GEOMETRY_BATCH_SIZE + 1];
+    int endX[GEOMETRY_BATCH_SIZE];
+    int endY[GEOMETRY_BATCH_SIZE];
+} Geometry;
+
+Geometry* Geometry_create();
+
+void ProgramCounter_reset(ProgramCounter* counter);
+
+int Geometry_compute(Geometry* geometry, TurtleSettings* settings,
+                     Program* program, ProgramCounter* counter);
+
+#endif
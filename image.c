@@ -0,0 +1,368 @@
+/**
+ * Implementation of an image writer for the canvas, for drawing without a
+ * terminal. Each cell becomes a square block of pixels in the terminal's
+ * colours, and the image is written as a binary PPM, PGM or PBM file depending
+ * on the extension of the file name. It can also be written as plain text, one
+ * line of the characters drawn for each row of cells.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "boolean.h"
+#include "image.h"
+#include "utils.h"
+
+/* Number of colours a cell can have, the 8 normal and 8 bold colours */
+#define NUM_COLOURS 16
+
+/* RGB values of the colour codes used by setFgColour() and setBgColour() */
+static const unsigned char PALETTE[NUM_COLOURS][3] =
+{
+    { 0, 0, 0 }, { 205, 0, 0 }, { 0, 205, 0 }, { 205, 205, 0 },
+    { 0, 0, 238 }, { 205, 0, 205 }, { 0, 205, 205 }, { 229, 229, 229 },
+    { 127, 127, 127 }, { 255, 0, 0 }, { 0, 255, 0 }, { 255, 255, 0 },
+    { 92, 92, 255 }, { 255, 0, 255 }, { 0, 255, 255 }, { 255, 255, 255 }
+};
+
+static int getFormat(char* fileName);
+
+static void fillCells(Cell* cells, int width, int scale, int isInner,
+                      int defaultFg, int defaultBg, unsigned char* colours);
+
+static size_t encodePixels(unsigned char* colours, int numPixels, int format,
+                           int defaultBg, unsigned char* bytes);
+
+static size_t encodeText(Cell* cells, int width, unsigned char* bytes);
+
+/**
+ * Writes a rectangle of the canvas to an image file, in the format given by
+ * the extension of its name. See Image_writeStream().
+ *
+ * Parameters:
+ *  canvas    - the Canvas to write
+ *  left      - the first column of the canvas in the image
+ *  top       - the first row of the canvas in the image
+ *  width     - the number of columns in the image, at most MAX_IMAGE_SIZE
+ *  height    - the number of rows in the image, at most MAX_IMAGE_SIZE
+ *  fileName  - the name of the image, ending in .ppm, .pgm or .pbm
+ *  scale     - the number of pixels along each side of a cell
+ *  defaultFg - the colour code (0-15) used for the default foreground colour
+ *  defaultBg - the colour code (0-15) used for the default background colour
+ *  errors    - the stream to print error messages to
+ * Returns:
+ *  An error code for a corresponding error, please see readCommandsFromFile()
+ *  in fileIO.c for details
+ */
+int Image_write(Canvas* canvas, int left, int top, int width, int height,
+                char* fileName, int scale, int defaultFg, int defaultBg,
+                FILE* errors)
+{
+    int errNo = 0;
+    FILE* file;
+    int format;
+
+    format = getFormat(fileName);
+    if (format == IMAGE_NONE)
+    {
+        format = IMAGE_PPM;
+    }
+
+    file = fopen(fileName, "wb");
+    if (file != NULL)
+    {
+        errNo = Image_writeStream(canvas, left, top, width, height, file, format,
+                                  scale, defaultFg, defaultBg, errors);
+        if (fclose(file) != 0 && errNo == 0)
+        {
+            errNo = 2; /* Error closing file */
+            printSystemError(errors, "ERROR: The image was not closed successfully");
+        }
+    }
+    else
+    {
+        errNo = 1; /* File could not be opened */
+        printSystemError(errors, "ERROR: The image could not be opened");
+    }
+
+    return errNo;
+}
+
+/**
+ * Writes a rectangle of the canvas to a stream as an image. A drawn cell is a
+ * block of its foreground colour. When a background colour was set it frames
+ * the block, a quarter of the scale wide, so small scales show the foreground
+ * only. Cells which were never drawn take the default background colour, and
+ * cells drawn before an FG command take the default foreground colour. PGM
+ * holds the brightness of each colour and PBM marks every pixel not in the
+ * default background colour. As IMAGE_TEXT, each row is written as the
+ * characters drawn in it, with a space for each cell never drawn, leaving out
+ * the spaces at the end; the scale and colours are not used.
+ *
+ * Parameters:
+ *  canvas    - the Canvas to write
+ *  left      - the first column of the canvas in the image
+ *  top       - the first row of the canvas in the image
+ *  width     - the number of columns in the image, at most MAX_IMAGE_SIZE
+ *  height    - the number of rows in the image, at most MAX_IMAGE_SIZE
+ *  file      - the stream to write to
+ *  format    - IMAGE_PPM, IMAGE_PGM, IMAGE_PBM or IMAGE_TEXT
+ *  scale     - the number of pixels along each side of a cell
+ *  defaultFg - the colour code (0-15) used for the default foreground colour
+ *  defaultBg - the colour code (0-15) used for the default background colour
+ *  errors    - the stream to print error messages to
+ * Returns:
+ *  An error code for a corresponding error, please see readCommandsFromFile()
+ *  in fileIO.c for details
+ */
+int Image_writeStream(Canvas* canvas, int left, int top, int width, int height,
+                      FILE* file, int format, int scale, int defaultFg,
+                      int defaultBg, FILE* errors)
+{
+    int errNo = 0;
+    int numPixels;
+    int y, py, inset;
+    unsigned char* outer;
+    unsigned char* inner;
+    unsigned char* bytes;
+    size_t numBytes;
+    Cell* cells;
+
+    if (format == IMAGE_TEXT)
+    {
+        scale = 1;
+    }
+    numPixels = width * scale;
+    inset = scale / 4;
+
+    /* Colours of the pixel rows through the border and middle of a row of
+     * cells, and the same pixels encoded for the file */
+    outer = (unsigned char*) malloc(numPixels);
+    inner = (unsigned char*) malloc(numPixels);
+    bytes = (unsigned char*) malloc(numPixels * 3 + 1);
+    cells = (Cell*) malloc(width * sizeof(Cell));
+    if (outer != NULL && inner != NULL && bytes != NULL && cells != NULL)
+    {
+        if (format != IMAGE_TEXT)
+        {
+            fprintf(file, "P%d\n%d %d\n", format == IMAGE_PBM ? 4 :
+                    (format == IMAGE_PGM ? 5 : 6), numPixels, height * scale);
+        }
+        if (format == IMAGE_PPM || format == IMAGE_PGM)
+        {
+            fprintf(file, "255\n");
+        }
+
+        for (y = 0; y < height && errNo == 0; y++)
+        {
+            Canvas_copyRow(canvas, top + y, left, width, cells);
+            if (format != IMAGE_TEXT)
+            {
+                fillCells(cells, width, scale, FALSE, defaultFg, defaultBg, outer);
+                fillCells(cells, width, scale, TRUE, defaultFg, defaultBg, inner);
+            }
+            for (py = 0; py < scale && errNo == 0; py++)
+            {
+                if (format == IMAGE_TEXT)
+                {
+                    numBytes = encodeText(cells, width, bytes);
+                }
+                else
+                {
+                    numBytes = encodePixels(py >= inset && py < scale - inset ?
+                                            inner : outer, numPixels, format,
+                                            defaultBg, bytes);
+                }
+                if (fwrite(bytes, 1, numBytes, file) != numBytes)
+                {
+                    errNo = 3; /* IO error */
+                    printSystemError(errors, "ERROR: The image could not be "
+                                             "written");
+                }
+            }
+        }
+    }
+    else
+    {
+        errNo = 3; /* System error */
+        fprintf(errors, "ERROR: Could not allocate memory for the image.\n");
+    }
+    free(outer);
+    free(inner);
+    free(bytes);
+    free(cells);
+
+    return errNo;
+}
+
+/**
+ * Checks whether a file name ends in the extension of an image, .ppm, .pgm or
+ * .pbm in any case.
+ *
+ * Parameters:
+ *  fileName - the file name to check
+ * Returns:
+ *  true(non-zero) if it is the name of an image, false(zero) otherwise
+ */
+int Image_isImageName(char* fileName)
+{
+    return getFormat(fileName) != IMAGE_NONE;
+}
+
+/**
+ * A private function that chooses the image format from the extension of the
+ * file name, which is IMAGE_NONE unless it is .ppm, .pgm or .pbm.
+ */
+static int getFormat(char* fileName)
+{
+    size_t length;
+    char extension[5];
+    int ii;
+    int format = IMAGE_NONE;
+
+    length = strlen(fileName);
+    if (length >= 4)
+    {
+        for (ii = 0; ii < 4; ii++)
+        {
+            extension[ii] = (char) tolower((unsigned char) fileName[length - 4 + ii]);
+        }
+        extension[4] = '\0';
+
+        if (strcmp(extension, ".ppm") == 0)
+        {
+            format = IMAGE_PPM;
+        }
+        else if (strcmp(extension, ".pgm") == 0)
+        {
+            format = IMAGE_PGM;
+        }
+        else if (strcmp(extension, ".pbm") == 0)
+        {
+            format = IMAGE_PBM;
+        }
+    }
+
+    return format;
+}
+
+/**
+ * A private function that works out the colour code of each pixel along one
+ * pixel row of a row of cells.
+ *
+ * Parameters:
+ *  cells   - the row of cells
+ *  width   - the number of cells in the row
+ *  scale   - the number of pixels along each side of a cell
+ *  isInner - true(non-zero) for the middle of the cells, false(zero) for the
+ *            border around it
+ *  colours - (export) the colour code of each pixel
+ */
+static void fillCells(Cell* cells, int width, int scale, int isInner,
+                      int defaultFg, int defaultBg, unsigned char* colours)
+{
+    int x, px, inset, colour, border;
+    Cell* cell;
+
+    inset = scale / 4;
+    for (x = 0; x < width; x++)
+    {
+        colour = defaultBg;
+        border = defaultBg;
+        if (cells[x].pattern != '\0')
+        {
+            cell = &(cells[x]);
+            colour = cell->fgColour == DEFAULT_COLOUR ? defaultFg : cell->fgColour;
+            border = cell->bgColour == DEFAULT_COLOUR ? colour : cell->bgColour;
+            if (!isInner)
+            {
+                colour = border;
+            }
+        }
+
+        for (px = 0; px < scale; px++)
+        {
+            colours[x * scale + px] = (unsigned char)
+                (px >= inset && px < scale - inset ? colour : border);
+        }
+    }
+}
+
+/**
+ * A private function that encodes a row of pixels in the image format: RGB for
+ * PPM, brightness for PGM, or one bit per pixel for PBM.
+ *
+ * Returns:
+ *  the number of bytes in the encoded row
+ */
+static size_t encodePixels(unsigned char* colours, int numPixels, int format,
+                           int defaultBg, unsigned char* bytes)
+{
+    int ii;
+    const unsigned char* rgb;
+    size_t numBytes;
+
+    if (format == IMAGE_PPM)
+    {
+        for (ii = 0; ii < numPixels; ii++)
+        {
+            memcpy(&(bytes[ii * 3]), PALETTE[colours[ii]], 3);
+        }
+        numBytes = (size_t) numPixels * 3;
+    }
+    else if (format == IMAGE_PGM)
+    {
+        for (ii = 0; ii < numPixels; ii++)
+        {
+            rgb = PALETTE[colours[ii]];
+            bytes[ii] = (unsigned char) ((299 * rgb[0] + 587 * rgb[1] +
+                                          114 * rgb[2]) / 1000);
+        }
+        numBytes = (size_t) numPixels;
+    }
+    else
+    {
+        /* Rows are padded to a whole byte, most significant bit first */
+        numBytes = (size_t) (numPixels + 7) / 8;
+        memset(bytes, 0, numBytes);
+        for (ii = 0; ii < numPixels; ii++)
+        {
+            if (colours[ii] != defaultBg)
+            {
+                bytes[ii / 8] |= (unsigned char) (0x80 >> (ii % 8));
+            }
+        }
+    }
+
+    return numBytes;
+}
+
+/**
+ * A private function that writes a row of cells as a line of text: the
+ * character drawn in each cell, or a space for a cell never drawn, without the
+ * spaces at the end.
+ *
+ * Parameters:
+ *  cells - the row of cells
+ *  width - the number of cells in the row
+ *  bytes - (export) the line, ending in '\n', with room for width + 1
+ * Returns:
+ *  the number of bytes in the line
+ */
+static size_t encodeText(Cell* cells, int width, unsigned char* bytes)
+{
+    int ii;
+    int length = 0;
+
+    for (ii = 0; ii < width; ii++)
+    {
+        bytes[ii] = (unsigned char) (cells[ii].pattern != '\0' ? cells[ii].pattern : ' ');
+        if (cells[ii].pattern != '\0' && cells[ii].pattern != ' ')
+        {
+            length = ii + 1;
+        }
+    }
+    bytes[length] = '\n';
+
+    return length + 1;
+}
@@ -0,0 +1,31 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdio.h>
+#include "canvas.h"
+
+/* Formats an image can be written in, or none for a file name which is not
+ * one of an image */
+#define IMAGE_NONE -1
+#define IMAGE_PPM 0
+#define IMAGE_PGM 1
+#define IMAGE_PBM 2
+#define IMAGE_TEXT 3
+
+/* Largest number of pixels along each side of a cell */
+#define MAX_IMAGE_SCALE 64
+
+/* Largest number of cells along each side of an image */
+#define MAX_IMAGE_SIZE MAX_CANVAS_SIZE
+
+int Image_write(Canvas* canvas, int left, int top, int width, int height,
+                char* fileName, int scale, int defaultFg, int defaultBg,
+                FILE* errors);
+
+int Image_writeStream(Canvas* canvas, int left, int top, int width, int height,
+                      FILE* file, int format, int scale, int defaultFg,
+                      int defaultBg, FILE* errors);
+
+int Image_isImageName(char* fileName);
+
+#endif
@@ -0,0 +1,394 @@
+/**
+ * Implementation of a zero-copy line reader. Regular files are mapped into
+ * memory and the lines are found with memchr, so no line is ever copied and
+ * there is no limit on the length of a line. Files which cannot be mapped are
+ * read in large blocks instead.
+ */
+
+/* mmap, fstat and read are POSIX, not C89 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "boolean.h"
+#include "lineReader.h"
+
+/* Size of the first block read when the file cannot be mapped */
+#define BLOCK_SIZE 65536
+
+static int LineReader_map(LineReader* reader);
+
+static void LineReader_fill(LineReader* reader);
+
+static int LineReader_closeFile(FILE* file);
+
+/**
+ * Opens a file for reading lines. Standard C file handling is used to open the
+ * file, so any error is reported through errno the same way as fopen(). The
+ * file name "-" reads from stdin.
+ *
+ * Parameters:
+ *  fileName - the name of the file to open, or "-" for stdin
+ * Returns:
+ *  reader - the LineReader, or NULL if the file could not be opened
+ */
+LineReader* LineReader_open(char* fileName)
+{
+    LineReader* reader = NULL;
+    FILE* file;
+
+    if (strcmp(fileName, STDIN_NAME) == 0)
+    {
+        file = stdin;
+    }
+    else
+    {
+        file = fopen(fileName, "r");
+    }
+
+    if (file != NULL)
+    {
+        reader = LineReader_openStream(file);
+    }
+
+    return reader;
+}
+
+/**
+ * Starts reading lines from a stream which is already open, such as a socket.
+ * The stream belongs to the LineReader from then on, and is closed with it
+ * unless it is stdin, even when the LineReader cannot be allocated.
+ *
+ * Parameters:
+ *  file - the stream to read from
+ * Returns:
+ *  reader - the LineReader, or NULL if the memory could not be allocated
+ */
+LineReader* LineReader_openStream(FILE* file)
+{
+    LineReader* reader = NULL;
+
+    reader = (LineReader*) malloc(sizeof(LineReader));
+    if (reader != NULL)
+    {
+        reader->file = file;
+        reader->map = NULL;
+        reader->mapSize = 0;
+        reader->buffer = NULL;
+        reader->bufferSize = 0;
+        reader->bufferLength = 0;
+        reader->pos = NULL;
+        reader->end = NULL;
+        reader->isEOF = FALSE;
+        reader->isError = FALSE;
+        if (!LineReader_map(reader))
+        {
+            /* Fall back to reading blocks, e.g. for pipes */
+            reader->buffer = (char*) malloc(BLOCK_SIZE + 1);
+            reader->bufferSize = BLOCK_SIZE;
+            if (reader->buffer == NULL)
+            {
+                LineReader_closeFile(file);
+                free(reader);
+                reader = NULL;
+            }
+            else
+            {
+                reader->buffer[0] = '\0';
+                reader->pos = reader->end = reader->buffer;
+            }
+        }
+    }
+    else
+    {
+        LineReader_closeFile(file);
+    }
+
+    return reader;
+}
+
+/**
+ * Retrieves the next line of the file, not including the newline character. The
+ * line stays valid until the next call.
+ *
+ * Parameters:
+ *  reader - the LineReader to read from
+ *  line   - (export) a pointer to the start of the line
+ *  length - (export) the number of characters in the line
+ * Returns:
+ *  true(non-zero) if a line was read, false(zero) at the end of the file or if
+ *  an IO error occurred, in which case isError is set
+ */
+int LineReader_next(LineReader* reader, char** line, int* length)
+{
+    char* newLine;
+    int isLine = FALSE;
+
+    if (reader->pos == reader->end && reader->map != NULL &&
+        reader->bufferLength > 0)
+    {
+        /* The mapping is used up, hand out the copied last line */
+        reader->pos = reader->buffer;
+        reader->end = reader->buffer + reader->bufferLength;
+        reader->bufferLength = 0;
+    }
+
+    newLine = (char*) memchr(reader->pos, '\n', reader->end - reader->pos);
+    /* Read more of the file until a whole line is in the buffer */
+    while (newLine == NULL && reader->map == NULL && !reader->isEOF &&
+           !reader->isError)
+    {
+        LineReader_fill(reader);
+        newLine = (char*) memchr(reader->pos, '\n', reader->end - reader->pos);
+    }
+
+    if (!reader->isError)
+    {
+        if (newLine != NULL)
+        {
+            *line = reader->pos;
+            *length = (int) (newLine - reader->pos);
+            reader->pos = newLine + 1;
+            isLine = TRUE;
+        }
+        else if (reader->pos < reader->end)
+        {
+            /* The last line of the file has no newline character */
+            *line = reader->pos;
+            *length = (int) (reader->end - reader->pos);
+            reader->pos = reader->end;
+            isLine = TRUE;
+        }
+    }
+
+    return isLine;
+}
+
+/**
+ * Retrieves every remaining line of a mapped file which ends in a newline
+ * character as one block, so the lines can be split up between threads. Each
+ * line of the block ends in '\n', including the last. A last line without a
+ * newline character is left for LineReader_next.
+ *
+ * Parameters:
+ *  reader - the LineReader to read from
+ *  block  - (export) a pointer to the start of the first line
+ *  length - (export) the number of characters in the block
+ * Returns:
+ *  true(non-zero) if there were lines in the mapping, false(zero) if the file
+ *  is not mapped or the mapping has been read
+ */
+int LineReader_nextBlock(LineReader* reader, char** block, size_t* length)
+{
+    int isBlock;
+
+    isBlock = reader->map != NULL && reader->pos < reader->end &&
+              reader->pos >= reader->map &&
+              reader->pos < reader->map + reader->mapSize;
+    if (isBlock)
+    {
+        *block = reader->pos;
+        *length = (size_t) (reader->end - reader->pos);
+        reader->pos = reader->end;
+    }
+
+    return isBlock;
+}
+
+/**
+ * Returns true(non-zero) if LineReader_next can return a line without waiting
+ * for more input, false(zero) otherwise.
+ */
+int LineReader_hasLine(LineReader* reader)
+{
+    return reader->map != NULL || reader->isEOF || reader->isError ||
+           memchr(reader->pos, '\n', reader->end - reader->pos) != NULL;
+}
+
+/**
+ * Returns true(non-zero) if every line of the file has been read or an IO error
+ * occurred, false(zero) otherwise.
+ */
+int LineReader_isAtEnd(LineReader* reader)
+{
+    /* A mapped file may still have its copied last line in the buffer */
+    return reader->isError ||
+           (reader->isEOF && reader->pos == reader->end &&
+            (reader->map == NULL || reader->bufferLength == 0));
+}
+
+/**
+ * Closes the file and frees the memory allocated to the LineReader. Stdin is
+ * left open.
+ *
+ * Parameters:
+ *  reader - the LineReader to close
+ * Returns:
+ *  0 on success, or EOF if the file was not closed successfully
+ */
+int LineReader_close(LineReader* reader)
+{
+    int result;
+
+    if (reader->map != NULL)
+    {
+        munmap(reader->map, reader->mapSize);
+    }
+    free(reader->buffer);
+    result = LineReader_closeFile(reader->file);
+    free(reader);
+
+    return result;
+}
+
+/**
+ * A private function that maps a regular file into memory. When the last line
+ * does not end in a newline there may be nothing readable after it, so that
+ * line alone is copied into the buffer and followed by a '\0'.
+ *
+ * Returns:
+ *  true(non-zero) if the whole file is available, false(zero) if it has to be
+ *  read in blocks
+ */
+static int LineReader_map(LineReader* reader)
+{
+    struct stat info;
+    char* lastLine;
+    size_t lastLength;
+    int isMapped = FALSE;
+
+    if (fstat(fileno(reader->file), &info) == 0 && S_ISREG(info.st_mode))
+    {
+        if (info.st_size == 0)
+        {
+            /* Nothing to map; an empty buffer is the whole file */
+            reader->buffer = (char*) malloc(1);
+            isMapped = reader->buffer != NULL;
+            reader->pos = reader->end = reader->buffer;
+            reader->isEOF = TRUE;
+        }
+        else
+        {
+            reader->map = (char*) mmap(NULL, (size_t) info.st_size, PROT_READ,
+                                       MAP_PRIVATE, fileno(reader->file), 0);
+            if (reader->map != (char*) MAP_FAILED)
+            {
+                reader->mapSize = (size_t) info.st_size;
+                reader->pos = reader->map;
+                reader->end = reader->map + reader->mapSize;
+                reader->isEOF = TRUE;
+                isMapped = TRUE;
+                if (reader->end[-1] != '\n')
+                {
+                    lastLine = reader->end - 1;
+                    while (lastLine > reader->map && lastLine[-1] != '\n')
+                    {
+                        lastLine--;
+                    }
+                    lastLength = (size_t) (reader->end - lastLine);
+                    reader->buffer = (char*) malloc(lastLength + 1);
+                    if (reader->buffer != NULL)
+                    {
+                        memcpy(reader->buffer, lastLine, lastLength);
+                        reader->buffer[lastLength] = '\0';
+                        reader->bufferLength = lastLength;
+                        /* Stop the mapping at the last line; it is handed out
+                         * from the buffer by LineReader_next */
+                        reader->end = lastLine;
+                    }
+                    else
+                    {
+                        munmap(reader->map, reader->mapSize);
+                        reader->map = NULL;
+                        reader->isEOF = FALSE;
+                        isMapped = FALSE;
+                    }
+                }
+            }
+            else
+            {
+                reader->map = NULL;
+            }
+        }
+    }
+
+    return isMapped;
+}
+
+/**
+ * A private function that moves the unread part of the buffer to the front and
+ * reads up to a block of the file after it, doubling the size of the buffer if
+ * a single line fills it. The data in the buffer is always followed by '\0'.
+ */
+static void LineReader_fill(LineReader* reader)
+{
+    size_t unread;
+    ssize_t numRead;
+    char* buffer;
+
+    unread = (size_t) (reader->end - reader->pos);
+    memmove(reader->buffer, reader->pos, unread);
+    if (unread == reader->bufferSize)
+    {
+        buffer = (char*) realloc(reader->buffer, reader->bufferSize * 2 + 1);
+        if (buffer != NULL)
+        {
+            reader->buffer = buffer;
+            reader->bufferSize *= 2;
+        }
+        else
+        {
+            reader->isError = TRUE;
+        }
+    }
+
+    numRead = 0;
+    if (!reader->isError)
+    {
+        /* read() returns as soon as some input is available, unlike fread()
+         * which would wait on a pipe until the whole block is filled */
+        do
+        {
+            numRead = read(fileno(reader->file), reader->buffer + unread,
+                           reader->bufferSize - unread);
+        }
+        while (numRead < 0 && errno == EINTR);
+
+        if (numRead < 0)
+        {
+            reader->isError = TRUE;
+            numRead = 0;
+        }
+        else if (numRead == 0)
+        {
+            reader->isEOF = TRUE;
+        }
+    }
+    reader->bufferLength = unread + numRead;
+    reader->buffer[reader->bufferLength] = '\0';
+    reader->pos = reader->buffer;
+    reader->end = reader->buffer + reader->bufferLength;
+}
+
+/**
+ * A private function that closes a file unless it is stdin.
+ *
+ * Returns:
+ *  0 on success, or EOF if the file was not closed successfully
+ */
+static int LineReader_closeFile(FILE* file)
+{
+    int result = 0;
+
+    if (file != stdin)
+    {
+        result = fclose(file);
+    }
+
+    return result;
+}
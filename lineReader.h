@@ -0,0 +1,44 @@
+#ifndef LINEREADER_H
+#define LINEREADER_H
+
+#include <stdio.h>
+
+/* The file name which reads from stdin instead of a file */
+#define STDIN_NAME "-"
+
+/**
+ * A struct representing a reader which hands out each line of a file as a
+ * pointer and length, without copying it. Regular files are memory-mapped and
+ * lines point straight into the mapping. Anything that cannot be mapped, such
+ * as a pipe, is read through a buffer instead. Either way a line is always
+ * followed by a '\n' or '\0', so it can be safely given to strtod().
+ */
+typedef struct
+{
+    FILE* file;
+    char* map;
+    size_t mapSize;
+    char* buffer;
+    size_t bufferSize;
+    size_t bufferLength;
+    char* pos;
+    char* end;
+    int isEOF;
+    int isError;
+} LineReader;
+
+LineReader* LineReader_open(char* fileName);
+
+LineReader* LineReader_openStream(FILE* file);
+
+int LineReader_next(LineReader* reader, char** line, int* length);
+
+int LineReader_nextBlock(LineReader* reader, char** block, size_t* length);
+
+int LineReader_hasLine(LineReader* reader);
+
+int LineReader_isAtEnd(LineReader* reader);
+
+int LineReader_close(LineReader* reader);
+
+#endif
@@ -0,0 +1,469 @@
+/**
+ * Implementation of a buffered log writer. Each MOVE and DRAW only stores a
+ * fixed-size record in a large buffer. Full buffers are handed to a background
+ * thread, which formats and writes them while the next buffer is filled, so
+ * printing the coordinates is kept out of the drawing loop. If the thread
+ * cannot be started the buffers are written by the drawing thread instead.
+ */
+
+/* pthreads are POSIX, not C89 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "boolean.h"
+#include "command.h"
+#include "logWriter.h"
+
+/* Number of records in each buffer */
+#define BATCH_SIZE 4096
+
+/**
+ * A struct representing an open log. The drawing thread fills 'records' while
+ * the writer thread writes 'pending'; the two are swapped under the lock when
+ * 'records' is full and the writer thread has finished with 'pending'. The
+ * file is only closed with the log when 'isOwned' is set, as it was opened by
+ * the LogWriter itself.
+ */
+struct LogWriter
+{
+    FILE* file;
+    int isOwned;
+    int isBinary;
+    LogRecord* records;
+    int numRecords;
+    LogRecord* pending;
+    int numPending;
+    int isThreaded;
+    int isClosing;
+    int isError;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+};
+
+static void* LogWriter_run(void* data);
+
+static void LogWriter_flush(LogWriter* log);
+
+static int writeRecords(FILE* file, int isBinary, LogRecord* records, int numRecords);
+
+static int printRecord(FILE* stream, LogRecord* record);
+
+/**
+ * Opens the log file in append mode, starts the writer thread and adds the
+ * separator which starts this run. Standard C file handling is used, so any
+ * error is reported through errno the same way as fopen().
+ *
+ * Parameters:
+ *  isBinary - true(non-zero) to write binary records to BINARY_LOG_NAME,
+ *             false(zero) to write text to TEXT_LOG_NAME
+ * Returns:
+ *  log - the LogWriter, or NULL if the file could not be opened
+ */
+LogWriter* LogWriter_open(int isBinary)
+{
+    LogWriter* log = NULL;
+    FILE* file;
+
+    if (isBinary)
+    {
+        file = fopen(BINARY_LOG_NAME, "ab");
+    }
+    else
+    {
+        file = fopen(TEXT_LOG_NAME, "a");
+    }
+
+    if (file != NULL)
+    {
+        log = LogWriter_openStream(file, isBinary);
+        if (log != NULL)
+        {
+            log->isOwned = TRUE;
+        }
+        else
+        {
+            fclose(file);
+        }
+    }
+
+    return log;
+}
+
+/**
+ * Starts a log written to a stream which is already open, such as a temporary
+ * file, and adds the separator which starts this run. The stream is flushed
+ * but left open when the LogWriter is closed.
+ *
+ * Parameters:
+ *  file     - the stream to write to
+ *  isBinary - true(non-zero) to write binary records, false(zero) to write text
+ * Returns:
+ *  log - the LogWriter, or NULL if the memory could not be allocated
+ */
+LogWriter* LogWriter_openStream(FILE* file, int isBinary)
+{
+    LogWriter* log = NULL;
+
+    log = (LogWriter*) malloc(sizeof(LogWriter));
+    if (log != NULL)
+    {
+        /* calloc so the padding written to the binary log is zeroed */
+        log->records = (LogRecord*) calloc(BATCH_SIZE, sizeof(LogRecord));
+        log->pending = (LogRecord*) calloc(BATCH_SIZE, sizeof(LogRecord));
+        if (log->records != NULL && log->pending != NULL)
+        {
+            log->file = file;
+            log->isOwned = FALSE;
+            log->isBinary = isBinary;
+            log->numPending = 0;
+            log->isClosing = FALSE;
+            log->isError = FALSE;
+
+            log->records[0].opcode = SEPARATOR_OPCODE;
+            log->numRecords = 1;
+
+            log->isThreaded = FALSE;
+            if (pthread_mutex_init(&log->lock, NULL) == 0)
+            {
+                if (pthread_cond_init(&log->changed, NULL) == 0)
+                {
+                    log->isThreaded = pthread_create(&log->thread, NULL,
+                                                     &LogWriter_run, log) == 0;
+                    if (!log->isThreaded)
+                    {
+                        pthread_cond_destroy(&log->changed);
+                    }
+                }
+                if (!log->isThreaded)
+                {
+                    pthread_mutex_destroy(&log->lock);
+                }
+            }
+        }
+        else
+        {
+            free(log->records);
+            free(log->pending);
+            free(log);
+            log = NULL;
+        }
+    }
+
+    return log;
+}
+
+/**
+ * Adds a record of a MOVE or DRAW to the log.
+ *
+ * Parameters:
+ *  log    - the LogWriter to add to
+ *  opcode - the opcode of the command
+ *  oldX   - the x coordinate before the command
+ *  oldY   - the y coordinate before the command
+ *  newX   - the x coordinate after the command
+ *  newY   - the y coordinate after the command
+ */
+void LogWriter_write(LogWriter* log, int opcode, double oldX, double oldY,
+                     double newX, double newY)
+{
+    LogRecord* record;
+
+    if (log->numRecords == BATCH_SIZE)
+    {
+        LogWriter_flush(log);
+    }
+
+    record = &(log->records[log->numRecords]);
+    record->oldX = oldX;
+    record->oldY = oldY;
+    record->newX = newX;
+    record->newY = newY;
+    record->opcode = opcode;
+    log->numRecords++;
+}
+
+/**
+ * Writes every remaining record, stops the writer thread, closes the file, or
+ * only flushes a stream given to LogWriter_openStream(), and frees the memory
+ * allocated to the LogWriter.
+ *
+ * Parameters:
+ *  log - the LogWriter to close
+ * Returns:
+ *  0 on success, or EOF if a record could not be written or the file was not
+ *  closed successfully
+ */
+int LogWriter_close(LogWriter* log)
+{
+    int result;
+
+    LogWriter_flush(log);
+    if (log->isThreaded)
+    {
+        pthread_mutex_lock(&log->lock);
+        log->isClosing = TRUE;
+        pthread_cond_broadcast(&log->changed);
+        pthread_mutex_unlock(&log->lock);
+        pthread_join(log->thread, NULL);
+        pthread_cond_destroy(&log->changed);
+        pthread_mutex_destroy(&log->lock);
+    }
+
+    if (log->isOwned)
+    {
+        result = fclose(log->file);
+    }
+    else
+    {
+        result = fflush(log->file);
+    }
+    if (log->isError)
+    {
+        result = EOF;
+    }
+    free(log->records);
+    free(log->pending);
+    free(log);
+
+    return result;
+}
+
+/**
+ * Copies the whole of a log written to a stream given to LogWriter_openStream()
+ * to the end of the log file, so the runs of drawings which were logged at the
+ * same time are not mixed up. Only one thread may add to the log file at a
+ * time.
+ *
+ * Parameters:
+ *  logFile - the log file to add to
+ *  runLog  - the log of the drawing
+ * Returns:
+ *  true(non-zero) on success, false(zero) if the log could not be copied
+ */
+int appendLog(FILE* logFile, FILE* runLog)
+{
+    char buffer[BUFSIZ];
+    size_t numRead;
+    int isCopied = TRUE;
+
+    rewind(runLog);
+    do
+    {
+        numRead = fread(buffer, 1, sizeof(buffer), runLog);
+        if (numRead > 0 && fwrite(buffer, 1, numRead, logFile) != numRead)
+        {
+            isCopied = FALSE;
+        }
+    }
+    while (numRead > 0 && isCopied);
+
+    return isCopied && !ferror(runLog) && fflush(logFile) == 0;
+}
+
+/**
+ * Prints a binary log in the same format as the text log.
+ *
+ * Parameters:
+ *  fileName - the name of the binary log file
+ *  stream   - the FILE pointer to print to
+ * Returns:
+ *  An error code for a corresponding error, please see readCommandsFromFile()
+ *  in fileIO.c for details
+ */
+int decodeLog(char* fileName, FILE* stream)
+{
+    int errNo = 0;
+    FILE* file;
+    LogRecord* records;
+    size_t numRead;
+    size_t ii;
+    int opcode;
+
+    file = fopen(fileName, "rb");
+    if (file != NULL)
+    {
+        records = (LogRecord*) malloc(BATCH_SIZE * sizeof(LogRecord));
+        if (records != NULL)
+        {
+            do
+            {
+                numRead = fread(records, sizeof(LogRecord), BATCH_SIZE, file);
+                for (ii = 0; ii < numRead && errNo == 0; ii++)
+                {
+                    opcode = records[ii].opcode;
+                    if (opcode == SEPARATOR_OPCODE ||
+                        (opcode >= 0 && opcode < NUM_COMMANDS))
+                    {
+                        printRecord(stream, &(records[ii]));
+                    }
+                    else
+                    {
+                        errNo = 3; /* Not a binary log */
+                        fprintf(stderr, "ERROR: The log file is corrupt.\n");
+                    }
+                }
+            }
+            while (numRead == BATCH_SIZE && errNo == 0);
+
+            if (errNo == 0 && ferror(file))
+            {
+                errNo = 3; /* IO error */
+                perror("ERROR: The log file could not be read");
+            }
+            else if (errNo == 0 && ftell(file) % (long) sizeof(LogRecord) != 0)
+            {
+                errNo = 3; /* Ends part way through a record */
+                fprintf(stderr, "ERROR: The log file is corrupt.\n");
+            }
+            free(records);
+        }
+        else
+        {
+            errNo = 3; /* System error */
+            fprintf(stderr, "ERROR: Could not allocate memory for the log.\n");
+        }
+
+        if (fclose(file) != 0)
+        {
+            errNo = 2; /* Error closing file */
+            perror("ERROR: The file was not closed successfully");
+        }
+    }
+    else
+    {
+        errNo = 1; /* File could not be opened */
+        perror("ERROR: The log file could not be opened");
+    }
+
+    return errNo;
+}
+
+/**
+ * A private function run by the writer thread. It waits for a pending buffer,
+ * writes it without holding the lock, then marks it as written, until the log
+ * is closed and nothing is pending.
+ */
+static void* LogWriter_run(void* data)
+{
+    LogWriter* log = (LogWriter*) data;
+    int isRunning = TRUE;
+    int isWritten;
+
+    pthread_mutex_lock(&log->lock);
+    while (isRunning)
+    {
+        if (log->numPending > 0)
+        {
+            /* The drawing thread does not touch 'pending' until it is empty */
+            pthread_mutex_unlock(&log->lock);
+            isWritten = writeRecords(log->file, log->isBinary, log->pending,
+                                     log->numPending);
+            pthread_mutex_lock(&log->lock);
+            if (!isWritten)
+            {
+                log->isError = TRUE;
+            }
+            log->numPending = 0;
+            pthread_cond_broadcast(&log->changed);
+        }
+        else if (log->isClosing)
+        {
+            isRunning = FALSE;
+        }
+        else
+        {
+            pthread_cond_wait(&log->changed, &log->lock);
+        }
+    }
+    pthread_mutex_unlock(&log->lock);
+
+    return NULL;
+}
+
+/**
+ * A private function that hands the filled buffer to the writer thread, waiting
+ * for it to finish the previous one first, or writes the buffer directly when
+ * there is no writer thread.
+ */
+static void LogWriter_flush(LogWriter* log)
+{
+    LogRecord* records;
+
+    if (log->isThreaded)
+    {
+        pthread_mutex_lock(&log->lock);
+        while (log->numPending > 0)
+        {
+            pthread_cond_wait(&log->changed, &log->lock);
+        }
+        records = log->pending;
+        log->pending = log->records;
+        log->records = records;
+        log->numPending = log->numRecords;
+        pthread_cond_broadcast(&log->changed);
+        pthread_mutex_unlock(&log->lock);
+    }
+    else if (!writeRecords(log->file, log->isBinary, log->records,
+                           log->numRecords))
+    {
+        log->isError = TRUE;
+    }
+    log->numRecords = 0;
+}
+
+/**
+ * A private function that writes records to a file, either as they are or in
+ * the text format.
+ *
+ * Returns:
+ *  true(non-zero) if every record was written, false(zero) otherwise
+ */
+static int writeRecords(FILE* file, int isBinary, LogRecord* records, int numRecords)
+{
+    int ii;
+    int isWritten = TRUE;
+
+    if (isBinary)
+    {
+        isWritten = fwrite(records, sizeof(LogRecord), (size_t) numRecords,
+                           file) == (size_t) numRecords;
+    }
+    else
+    {
+        for (ii = 0; ii < numRecords; ii++)
+        {
+            if (printRecord(file, &(records[ii])) < 0)
+            {
+                isWritten = FALSE;
+            }
+        }
+    }
+
+    return isWritten;
+}
+
+/**
+ * A private function that prints a record as a line of the text log.
+ *
+ * Returns:
+ *  a negative number if the line could not be printed
+ */
+static int printRecord(FILE* stream, LogRecord* record)
+{
+    int result;
+
+    if (record->opcode == SEPARATOR_OPCODE)
+    {
+        result = fputs(LOG_SEPARATOR, stream);
+    }
+    else
+    {
+        result = fprintf(stream, LOG_FORMAT, getCommandInfo(record->opcode)->name,
+                         record->oldX, record->oldY, record->newX, record->newY);
+    }
+
+    return result;
+}
@@ -0,0 +1,49 @@
+#ifndef LOGWRITER_H
+#define LOGWRITER_H
+
+#include <stdio.h>
+
+/* Format of each line of the text log */
+#define LOG_FORMAT "%s (%7.3f, %7.3f)-(%7.3f, %7.3f)\n"
+
+/* Line of the text log which starts each run of the program */
+#define LOG_SEPARATOR "---\n"
+
+/* The log files written in text and binary */
+#define TEXT_LOG_NAME "graphics.log"
+#define BINARY_LOG_NAME "graphics.bin"
+
+/* Opcode of the record which starts each run in the binary log */
+#define SEPARATOR_OPCODE 255
+
+/**
+ * A struct representing one fixed-size record of the log: the opcode of a MOVE
+ * or DRAW and the coordinates before and after it. The binary log is an array
+ * of these in the byte order of the machine which wrote it.
+ */
+typedef struct
+{
+    double oldX;
+    double oldY;
+    double newX;
+    double newY;
+    int opcode;
+} LogRecord;
+
+/* The LogWriter is private to logWriter.c, as it holds the writer thread */
+typedef struct LogWriter LogWriter;
+
+LogWriter* LogWriter_open(int isBinary);
+
+LogWriter* LogWriter_openStream(FILE* file, int isBinary);
+
+void LogWriter_write(LogWriter* log, int opcode, double oldX, double oldY,
+                     double newX, double newY);
+
+int LogWriter_close(LogWriter* log);
+
+int appendLog(FILE* logFile, FILE* runLog);
+
+int decodeLog(char* fileName, FILE* stream);
+
+#endif
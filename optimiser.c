@@ -0,0 +1,292 @@
+/**
+ * Implementation of a peephole optimiser which removes commands from a Program
+ * without changing what is drawn. The heading and the position are worked out
+ * in the same way as Geometry_compute(), so every change can be checked to give
+ * exactly the same numbers, and the Program still stops at the same command
+ * when the turtle goes out of bounds. The commands are rewritten in place.
+ *
+ * At every level:
+ *  - runs of ROTATE become one ROTATE, or none when they add up to nothing
+ *  - FG, BG and PATTERN are only kept before the next DRAW, and only when they
+ *    change the pen
+ *  - commands after the last MOVE or DRAW, and after the command the Program
+ *    stops at, are removed
+ * At OPTIMISE_RELAXED, which changes graphics.log:
+ *  - runs of MOVE in the same direction become one MOVE, and MOVE 0 goes
+ * A Program with REPEAT blocks is left as it is, as the turtle is somewhere
+ * different each time their bodies are executed.
+ */
+
+#include <stdlib.h>
+#include "boolean.h"
+#include "optimiser.h"
+#include "command.h"
+
+/* FG or BG value of a pen whose colour is not known */
+#define UNKNOWN_COLOUR -2
+
+/**
+ * A struct representing the optimised Program being written over the original.
+ * The commands read but not written yet are held back: a run of ROTATE from
+ * 'rotateFirst', the last FG, BG and PATTERN, and at OPTIMISE_RELAXED a MOVE of
+ * 'moveDistance' from ('moveX', 'moveY'). 'angle' is the heading after the
+ * commands written so far, and fgColour, bgColour and pattern the pen.
+ */
+typedef struct
+{
+    Program* program;
+    int size;
+    double angle;
+    int rotateFirst;
+    int fgColour;
+    int bgColour;
+    char pattern;
+    int pendingFg;
+    int pendingBg;
+    char pendingPattern;
+    int isMovePending;
+    double moveX;
+    double moveY;
+    double moveAngle;
+    double moveDistance;
+} Output;
+
+static void writeCommand(Output* output, int opcode, CommandValue value);
+
+static void writeRotation(Output* output, int last, double angle);
+
+static void writeMove(Output* output);
+
+static void writePen(Output* output);
+
+/**
+ * Optimises a Program which has not been executed and has no REPEAT blocks, so
+ * it draws exactly the same as before with fewer commands. At OPTIMISE_EXACT
+ * graphics.log is also exactly the same, as every MOVE and DRAW is kept.
+ * Commands are only written over ones which have already been read.
+ *
+ * Parameters:
+ *  program - the Program to optimise
+ *  level   - OPTIMISE_EXACT or OPTIMISE_RELAXED
+ * Returns:
+ *  the number of commands removed
+ */
+int optimiseProgram(Program* program, int level)
+{
+    TurtleSettings* settings;
+    Output output;
+    int ii, opcode, size;
+    CommandValue value;
+    double x, y, angle, directionX, directionY;
+    double newX, newY, distance;
+    int isJoined, isLooped;
+
+    size = program->size;
+    isLooped = FALSE;
+    for (ii = 0; ii < size; ii++)
+    {
+        if (program->opcodes[ii] == CMD_REPEAT)
+        {
+            isLooped = TRUE;
+        }
+    }
+    settings = createSettings();
+    if (settings != NULL && level != OPTIMISE_OFF && !isLooped)
+    {
+        output.program = program;
+        output.size = 0;
+        output.angle = settings->angle;
+        output.rotateFirst = -1;
+        /* The canvas draws in the terminal's own colours until FG or BG */
+        output.fgColour = UNKNOWN_COLOUR;
+        output.bgColour = UNKNOWN_COLOUR;
+        output.pattern = settings->pattern;
+        output.pendingFg = UNKNOWN_COLOUR;
+        output.pendingBg = UNKNOWN_COLOUR;
+        output.pendingPattern = '\0';
+        output.isMovePending = FALSE;
+
+        x = settings->pos.x;
+        y = settings->pos.y;
+        angle = settings->angle;
+        directionX = settings->direction.x;
+        directionY = settings->direction.y;
+
+        /* The same bounds check as Geometry_compute(), for a bounded drawing */
+        ii = 0;
+        while (ii < size && isPositionValid(settings, x, y))
+        {
+            opcode = program->opcodes[ii];
+            value = program->values[ii];
+            if (opcode == CMD_ROTATE)
+            {
+                angle = adjustAngle(angle + value.real);
+                unitVector(angle, &directionX, &directionY);
+                if (output.rotateFirst < 0)
+                {
+                    output.rotateFirst = ii;
+                }
+            }
+            else if (opcode == CMD_FG)
+            {
+                output.pendingFg = value.integer;
+            }
+            else if (opcode == CMD_BG)
+            {
+                output.pendingBg = value.integer;
+            }
+            else if (opcode == CMD_PATTERN)
+            {
+                output.pendingPattern = value.character;
+            }
+            else
+            {
+                newX = x + value.real * directionX;
+                newY = y + -(value.real * directionY);
+
+                /* A MOVE is only joined to the one before if the turtle ends up
+                 * at exactly the same place */
+                isJoined = FALSE;
+                if (opcode == CMD_MOVE && output.isMovePending &&
+                    angle == output.moveAngle)
+                {
+                    distance = output.moveDistance + value.real;
+                    isJoined = output.moveX + distance * directionX == newX &&
+                               output.moveY + -(distance * directionY) == newY;
+                    if (isJoined)
+                    {
+                        output.moveDistance = distance;
+                        output.rotateFirst = -1;
+                    }
+                }
+
+                if (!isJoined)
+                {
+                    writeMove(&output);
+                    writeRotation(&output, ii, angle);
+                    if (opcode == CMD_DRAW)
+                    {
+                        writePen(&output);
+                    }
+                    if (opcode == CMD_MOVE && level == OPTIMISE_RELAXED)
+                    {
+                        output.isMovePending = TRUE;
+                        output.moveX = x;
+                        output.moveY = y;
+                        output.moveAngle = angle;
+                        output.moveDistance = value.real;
+                    }
+                    else
+                    {
+                        writeCommand(&output, opcode, value);
+                    }
+                }
+                x = newX;
+                y = newY;
+            }
+            ii++;
+        }
+
+        writeMove(&output);
+        if (ii < size)
+        {
+            /* Keep the command the Program stops at, so it still stops */
+            writeCommand(&output, program->opcodes[ii], program->values[ii]);
+        }
+        program->size = output.size;
+    }
+    free(settings);
+
+    return size - program->size;
+}
+
+/**
+ * A private function that writes a command to the end of the optimised Program.
+ */
+static void writeCommand(Output* output, int opcode, CommandValue value)
+{
+    output->program->opcodes[output->size] = (unsigned char) opcode;
+    output->program->values[output->size] = value;
+    (output->size)++;
+}
+
+/**
+ * A private function that writes the ROTATE commands held back, which turned
+ * the turtle to 'angle'. They become a single ROTATE when adding it gives
+ * exactly the same angle, and nothing when the angle has not changed;
+ * otherwise each ROTATE from rotateFirst up to 'last' is written as it was.
+ */
+static void writeRotation(Output* output, int last, double angle)
+{
+    Program* program = output->program;
+    CommandValue value;
+    int ii;
+
+    if (angle != output->angle)
+    {
+        value.real = angle - output->angle;
+        if (adjustAngle(output->angle + value.real) == angle)
+        {
+            writeCommand(output, CMD_ROTATE, value);
+        }
+        else
+        {
+            for (ii = output->rotateFirst; ii < last; ii++)
+            {
+                if (program->opcodes[ii] == CMD_ROTATE)
+                {
+                    writeCommand(output, CMD_ROTATE, program->values[ii]);
+                }
+            }
+        }
+        output->angle = angle;
+    }
+    output->rotateFirst = -1;
+}
+
+/**
+ * A private function that writes the MOVE held back, if there is one and it
+ * goes anywhere.
+ */
+static void writeMove(Output* output)
+{
+    CommandValue value;
+
+    if (output->isMovePending && output->moveDistance != 0.0)
+    {
+        value.real = output->moveDistance;
+        writeCommand(output, CMD_MOVE, value);
+    }
+    output->isMovePending = FALSE;
+}
+
+/**
+ * A private function that writes the FG, BG and PATTERN held back which change
+ * the pen, before a DRAW.
+ */
+static void writePen(Output* output)
+{
+    CommandValue value;
+
+    if (output->pendingFg != UNKNOWN_COLOUR && output->pendingFg != output->fgColour)
+    {
+        value.integer = output->pendingFg;
+        writeCommand(output, CMD_FG, value);
+        output->fgColour = output->pendingFg;
+    }
+    if (output->pendingBg != UNKNOWN_COLOUR && output->pendingBg != output->bgColour)
+    {
+        value.integer = output->pendingBg;
+        writeCommand(output, CMD_BG, value);
+        output->bgColour = output->pendingBg;
+    }
+    if (output->pendingPattern != '\0' && output->pendingPattern != output->pattern)
+    {
+        value.character = output->pendingPattern;
+        writeCommand(output, CMD_PATTERN, value);
+        output->pattern = output->pendingPattern;
+    }
+    output->pendingFg = UNKNOWN_COLOUR;
+    output->pendingBg = UNKNOWN_COLOUR;
+    output->pendingPattern = '\0';
+}
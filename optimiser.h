@@ -0,0 +1,14 @@
+#ifndef OPTIMISER_H
+#define OPTIMISER_H
+
+#include "program.h"
+
+/* Levels of optimisation: none, keeping graphics.log exactly the same, and
+ * also joining MOVEs, which gives graphics.log fewer records */
+#define OPTIMISE_OFF 0
+#define OPTIMISE_EXACT 1
+#define OPTIMISE_RELAXED 2
+
+int optimiseProgram(Program* program, int level);
+
+#endif
@@ -0,0 +1,175 @@
+/**
+ * Implementation of a growable, contiguous program of commands.
+ */
+
+/* munmap is POSIX, not C89 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <string.h>
+#include "boolean.h"
+#include <sys/mman.h>
+#include "program.h"
+
+/* Number of commands a new Program has room for */
+#define INITIAL_CAPACITY 256
+
+/**
+ * Allocates enough memory for an empty Program and initialises all fields to
+ * their default values and returns the Program.
+ *
+ * Returns:
+ *  program - an empty Program, or NULL if the memory could not be allocated
+ */
+Program* Program_create()
+{
+    Program* program = (Program*) malloc(sizeof(Program));
+
+    if (program != NULL)
+    {
+        program->opcodes = (unsigned char*) malloc(INITIAL_CAPACITY * sizeof(unsigned char));
+        program->values = (CommandValue*) malloc(INITIAL_CAPACITY * sizeof(CommandValue));
+        program->size = 0;
+        program->capacity = INITIAL_CAPACITY;
+        program->map = NULL;
+        program->mapSize = 0;
+        if (program->opcodes == NULL || program->values == NULL)
+        {
+            Program_free(program);
+            program = NULL;
+        }
+    }
+
+    return program;
+}
+
+/**
+ * Appends a command to the end of the Program, doubling the capacity of both
+ * arrays when they are full.
+ *
+ * Parameters:
+ *  program - the Program to append to
+ *  opcode  - the opcode of the command
+ *  value   - the value of the command
+ * Returns:
+ *  true(non-zero) on success, false(zero) if memory ran out
+ */
+int Program_append(Program* program, int opcode, CommandValue value)
+{
+    unsigned char* opcodes;
+    CommandValue* values;
+    int isAppended = TRUE;
+
+    if (program->size == program->capacity)
+    {
+        opcodes = (unsigned char*) realloc(program->opcodes,
+                                           program->capacity * 2 * sizeof(unsigned char));
+        if (opcodes != NULL)
+        {
+            program->opcodes = opcodes;
+        }
+        values = (CommandValue*) realloc(program->values,
+                                         program->capacity * 2 * sizeof(CommandValue));
+        if (values != NULL)
+        {
+            program->values = values;
+        }
+        if (opcodes != NULL && values != NULL)
+        {
+            program->capacity *= 2;
+        }
+        else
+        {
+            isAppended = FALSE;
+        }
+    }
+
+    if (isAppended)
+    {
+        program->opcodes[program->size] = (unsigned char) opcode;
+        program->values[program->size] = value;
+        (program->size)++;
+    }
+
+    return isAppended;
+}
+
+/**
+ * Appends every command of another Program to the end of the Program, growing
+ * both arrays at most once.
+ *
+ * Parameters:
+ *  program - the Program to append to
+ *  other   - the Program whose commands are appended, which is not changed
+ * Returns:
+ *  true(non-zero) on success, false(zero) if memory ran out
+ */
+int Program_appendProgram(Program* program, Program* other)
+{
+    unsigned char* opcodes;
+    CommandValue* values;
+    int capacity;
+    int isAppended = TRUE;
+
+    if (program->size + other->size > program->capacity)
+    {
+        capacity = program->capacity;
+        while (capacity < program->size + other->size)
+        {
+            capacity *= 2;
+        }
+        opcodes = (unsigned char*) realloc(program->opcodes,
+                                           capacity * sizeof(unsigned char));
+        if (opcodes != NULL)
+        {
+            program->opcodes = opcodes;
+        }
+        values = (CommandValue*) realloc(program->values,
+                                         capacity * sizeof(CommandValue));
+        if (values != NULL)
+        {
+            program->values = values;
+        }
+        if (opcodes != NULL && values != NULL)
+        {
+            program->capacity = capacity;
+        }
+        else
+        {
+            isAppended = FALSE;
+        }
+    }
+
+    if (isAppended)
+    {
+        memcpy(program->opcodes + program->size, other->opcodes,
+               other->size * sizeof(unsigned char));
+        memcpy(program->values + program->size, other->values,
+               other->size * sizeof(CommandValue));
+        program->size += other->size;
+    }
+
+    return isAppended;
+}
+
+/**
+ * Frees the memory allocated to a Program and its commands, or unmaps the
+ * commands of a Program read from a compiled file.
+ *
+ * Parameters:
+ *  program - the Program to free
+ */
+void Program_free(Program* program)
+{
+    if (program != NULL && program->map != NULL)
+    {
+        munmap(program->map, program->mapSize);
+        free(program);
+    }
+    else if (program != NULL)
+    {
+        free(program->opcodes);
+        free(program->values);
+        free(program);
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include <stddef.h>
+
+/**
+ * The value of a command, stored inline. ROTATE, MOVE and DRAW use 'real', FG
+ * and BG use 'integer', and PATTERN uses 'character'.
+ */
+typedef union
+{
+    double real;
+    int integer;
+    char character;
+} CommandValue;
+
+/**
+ * A struct representing a program of commands stored as two parallel,
+ * contiguous arrays: one opcode byte per command and one inline value per
+ * command. The arrays double in capacity as commands are appended, so a
+ * command costs nine bytes and executing the program is a linear walk.
+ * A Program read from a compiled file points into the file's mapping of
+ * 'mapSize' bytes at 'map' instead, and must not be appended to; 'map' is NULL
+ * otherwise.
+ */
+typedef struct
+{
+    unsigned char* opcodes;
+    CommandValue* values;
+    int size;
+    int capacity;
+    void* map;
+    size_t mapSize;
+} Program;
+
+Program* Program_create();
+
+int Program_append(Program* program, int opcode, CommandValue value);
+
+int Program_appendProgram(Program* program, Program* other);
+
+void Program_free(Program* program);
+
+#endif
@@ -0,0 +1,604 @@
+/**
+ * Implementation of compiled program files, which hold a validated Program in
+ * the same layout it has in memory. Reading one maps the file and checks its
+ * header, checksum and commands, with no text to parse. A compiled copy of a
+ * text file can also be cached beside it, and is reused for as long as the text
+ * file's size, time of last change and hash stay the same.
+ */
+
+/* mmap, fstat, open, getpid and pthreads are POSIX, not C89 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "boolean.h"
+#include "programFile.h"
+#include "fileIO.h"
+
+/* Written into every header, and reads differently on a machine with the other
+ * byte order */
+#define BYTE_ORDER_MARK 0x01020304
+
+/* Starting value and multiplier of the FNV-1a hash, taken a word at a time */
+#define HASH_START 2166136261U
+#define HASH_PRIME 16777619U
+
+/* Number of values normalised and written at a time */
+#define WRITE_BATCH_SIZE 1024
+
+/* Number of temporary files named so far, so every thread writing a program
+ * file at the same time uses a name of its own */
+static long numTempNames = 0;
+static pthread_mutex_t tempNameLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * A struct describing a text file when it was read: its size in bytes, the time
+ * it was last changed and the hash of its contents.
+ */
+typedef struct
+{
+    long size;
+    long time;
+    unsigned int hash;
+} SourceInfo;
+
+static int mapProgramFile(char* fileName, Program** program, SourceInfo* source);
+
+static int writeProgram(Program* program, char* fileName, SourceInfo* source,
+                        int isQuiet);
+
+static int normaliseValues(Program* program, int first, CommandValue* batch);
+
+static int getSourceInfo(char* fileName, SourceInfo* source);
+
+static unsigned int hashBytes(unsigned int hash, const void* bytes, size_t length);
+
+static int isValidCommand(int opcode, CommandValue* value);
+
+/**
+ * Returns true(non-zero) if the file starts like a compiled program file,
+ * false(zero) if it does not or cannot be read. Only a regular file can be
+ * one, as reading the start of a pipe or of standard input would lose it.
+ */
+int isProgramFile(char* fileName)
+{
+    char magic[PROGRAM_MAGIC_SIZE];
+    FILE* file;
+    struct stat info;
+    int isProgram = FALSE;
+
+    if (strcmp(fileName, "-") != 0 && stat(fileName, &info) == 0 &&
+        S_ISREG(info.st_mode))
+    {
+        file = fopen(fileName, "rb");
+        if (file != NULL)
+        {
+            isProgram = fread(magic, 1, PROGRAM_MAGIC_SIZE, file) == PROGRAM_MAGIC_SIZE &&
+                        memcmp(magic, PROGRAM_MAGIC, PROGRAM_MAGIC_SIZE) == 0;
+            fclose(file);
+        }
+    }
+
+    return isProgram;
+}
+
+/**
+ * Writes a Program to a compiled program file, recording the text file it was
+ * compiled from. A regular file is written under a temporary name and then
+ * renamed, so a half-written file is never seen under its real name.
+ *
+ * Parameters:
+ *  program    - the Program to write
+ *  fileName   - the name of the compiled program file
+ *  sourceName - the name of the text file the Program was read from
+ * Returns:
+ *  0 - on success
+ *  1 - if the file could not be opened or renamed
+ *  2 - if the file could not be closed
+ *  3 - if there is a system error while writing the file
+ */
+int writeProgramFile(Program* program, char* fileName, char* sourceName)
+{
+    SourceInfo source;
+
+    if (strcmp(sourceName, "-") == 0 || !getSourceInfo(sourceName, &source))
+    {
+        source.size = -1;
+        source.time = -1;
+        source.hash = 0;
+    }
+
+    return writeProgram(program, fileName, &source, FALSE);
+}
+
+/**
+ * Reads a compiled program file by mapping it into memory. The Program points
+ * into the mapping, so nothing is copied, but it cannot be appended to.
+ *
+ * Parameters:
+ *  fileName - the name of the compiled program file
+ *  program  - (export) the Program of commands, or NULL on error
+ *  errors   - the stream to print error messages to
+ * Returns:
+ *  0 - on success
+ *  1 - if the file could not be opened
+ *  2 - if the file could not be closed
+ *  3 - if the file could not be mapped or there is not enough memory
+ *  4 - if the program has no commands
+ *  9 - if the file is damaged or was compiled by a different version
+ */
+int readProgramFile(char* fileName, Program** program, FILE* errors)
+{
+    int errNo;
+
+    errNo = mapProgramFile(fileName, program, NULL);
+    if (errNo == 1)
+    {
+        printSystemError(errors, "ERROR: The file could not be opened");
+    }
+    else if (errNo == 2)
+    {
+        printSystemError(errors, "ERROR: The file was not closed successfully");
+    }
+    else if (errNo == 3)
+    {
+        printSystemError(errors, "ERROR: The compiled program could not be read");
+    }
+    else if (errNo == 4)
+    {
+        fprintf(errors, "ERROR: The input file is empty.\n");
+    }
+    else if (errNo == 9)
+    {
+        fprintf(errors, "ERROR: The file is damaged or was compiled by a "
+                        "different version.\n");
+    }
+
+    return errNo;
+}
+
+/**
+ * Reads a text file the same way as readCommandsFromFile, but keeps a compiled
+ * copy of it in a file named with CACHE_SUFFIX added. The copy is read instead
+ * of the text whenever it was compiled from a file of the same size, time of
+ * last change and hash. A missing, stale or damaged copy is replaced quietly,
+ * and if it cannot be written the text is still read.
+ *
+ * Returns:
+ *  the same error codes as readCommandsFromFile
+ */
+int readCommandsCached(char* fileName, Program** program, int numThreads,
+                       FILE* errors)
+{
+    int errNo = 0;
+    SourceInfo source;
+    char* cacheName;
+    int isSourceKnown, isCached;
+
+    isCached = FALSE;
+    cacheName = (char*) malloc(strlen(fileName) + strlen(CACHE_SUFFIX) + 1);
+    isSourceKnown = cacheName != NULL && strcmp(fileName, "-") != 0 &&
+                    getSourceInfo(fileName, &source);
+    if (isSourceKnown)
+    {
+        sprintf(cacheName, "%s%s", fileName, CACHE_SUFFIX);
+        isCached = mapProgramFile(cacheName, program, &source) == 0;
+    }
+
+    if (!isCached)
+    {
+        errNo = readCommandsFromFile(fileName, program, numThreads, errors);
+        if (errNo == 0 && isSourceKnown)
+        {
+            writeProgram(*program, cacheName, &source, TRUE);
+        }
+    }
+    free(cacheName);
+
+    return errNo;
+}
+
+/**
+ * A private function that maps a compiled program file and checks it. When a
+ * source is given, the file must also have been compiled from it.
+ *
+ * Parameters:
+ *  fileName - the name of the compiled program file
+ *  program  - (export) the Program of commands, or NULL on error
+ *  source   - the text file it must have been compiled from, or NULL
+ * Returns:
+ *  the same error codes as readProgramFile, without printing anything
+ */
+static int mapProgramFile(char* fileName, Program** program, SourceInfo* source)
+{
+    int errNo = 0;
+    FILE* file;
+    struct stat info;
+    char* map = NULL;
+    size_t mapSize = 0;
+    ProgramHeader* header;
+    CommandValue* values;
+    unsigned char* opcodes;
+    long ii, numCommands = 0;
+    unsigned int checksum;
+    int numValid;
+
+    (*program) = NULL;
+    file = fopen(fileName, "rb");
+    if (file == NULL)
+    {
+        errNo = 1; /* File could not be opened */
+    }
+    else if (fstat(fileno(file), &info) != 0)
+    {
+        errNo = 3; /* System error */
+    }
+    else if (info.st_size < (long) sizeof(ProgramHeader))
+    {
+        errNo = 9; /* Not a compiled program */
+    }
+    else
+    {
+        /* Private and writable, so the Program can be optimised in place
+         * without changing the file */
+        mapSize = (size_t) info.st_size;
+        map = (char*) mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                           fileno(file), 0);
+        if (map == (char*) MAP_FAILED)
+        {
+            map = NULL;
+            errNo = 3; /* System error */
+        }
+    }
+
+    if (errNo == 0)
+    {
+        header = (ProgramHeader*) map;
+        numCommands = header->numCommands;
+        if (memcmp(header->magic, PROGRAM_MAGIC, PROGRAM_MAGIC_SIZE) != 0 ||
+            header->version != PROGRAM_VERSION ||
+            header->valueSize != sizeof(CommandValue) ||
+            header->byteOrder != BYTE_ORDER_MARK ||
+            numCommands < 0 || numCommands > INT_MAX ||
+            (size_t) numCommands * (sizeof(CommandValue) + 1) !=
+                mapSize - sizeof(ProgramHeader))
+        {
+            errNo = 9; /* Damaged or from another version */
+        }
+        else if (source != NULL && (header->sourceSize != source->size ||
+                                    header->sourceTime != source->time ||
+                                    header->sourceHash != source->hash))
+        {
+            errNo = 9; /* Compiled from a different file */
+        }
+        else if (numCommands == 0)
+        {
+            errNo = 4; /* No commands */
+        }
+    }
+
+    if (errNo == 0)
+    {
+        values = (CommandValue*) (map + sizeof(ProgramHeader));
+        opcodes = (unsigned char*) (values + numCommands);
+        checksum = hashBytes(HASH_START, values,
+                             (size_t) numCommands * sizeof(CommandValue));
+        checksum = hashBytes(checksum, opcodes, (size_t) numCommands);
+        if (checksum != header->checksum)
+        {
+            errNo = 9; /* Damaged */
+        }
+        for (ii = 0; ii < numCommands && errNo == 0; ii++)
+        {
+            if (!isValidCommand(opcodes[ii], &values[ii]))
+            {
+                errNo = 9; /* Damaged */
+            }
+        }
+    }
+
+    if (errNo == 0)
+    {
+        (*program) = (Program*) malloc(sizeof(Program));
+        if ((*program) != NULL)
+        {
+            (*program)->opcodes = opcodes;
+            (*program)->values = values;
+            (*program)->size = (int) numCommands;
+            (*program)->capacity = (int) numCommands;
+            (*program)->map = map;
+            (*program)->mapSize = mapSize;
+        }
+        else
+        {
+            errNo = 3; /* System error */
+        }
+    }
+    if (errNo == 0 && checkRepeats(*program, &numValid, NULL) != 0)
+    {
+        errNo = 9; /* Damaged */
+        free(*program);
+        (*program) = NULL;
+    }
+
+    if (errNo != 0 && map != NULL)
+    {
+        munmap(map, mapSize);
+    }
+    if (file != NULL && fclose(file) != 0 && errNo == 0)
+    {
+        errNo = 2; /* Error closing file */
+        Program_free(*program);
+        (*program) = NULL;
+    }
+
+    return errNo;
+}
+
+/**
+ * A private function that does the work of writeProgramFile, printing an error
+ * message unless isQuiet is set. The file is written from start to end, so it
+ * can also be a pipe or a device, which are written directly instead of being
+ * renamed over. The temporary name holds the process ID and a count, so
+ * threads writing the same file at once never share one.
+ */
+static int writeProgram(Program* program, char* fileName, SourceInfo* source,
+                        int isQuiet)
+{
+    int errNo = 0;
+    ProgramHeader header;
+    CommandValue batch[WRITE_BATCH_SIZE];
+    struct stat info;
+    char* tempName = NULL;
+    FILE* file = NULL;
+    int descriptor;
+    long tempNumber;
+    int ii, count;
+
+    memset(&header, 0, sizeof(ProgramHeader));
+    memcpy(header.magic, PROGRAM_MAGIC, PROGRAM_MAGIC_SIZE);
+    header.version = PROGRAM_VERSION;
+    header.valueSize = sizeof(CommandValue);
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.numCommands = program->size;
+    header.sourceSize = source->size;
+    header.sourceTime = source->time;
+    header.sourceHash = source->hash;
+
+    /* The checksum is worked out first, so the header can go at the start */
+    header.checksum = HASH_START;
+    for (ii = 0; ii < program->size; ii += count)
+    {
+        count = normaliseValues(program, ii, batch);
+        header.checksum = hashBytes(header.checksum, batch,
+                                    count * sizeof(CommandValue));
+    }
+    header.checksum = hashBytes(header.checksum, program->opcodes,
+                                (size_t) program->size);
+
+    if (stat(fileName, &info) == 0 && !S_ISREG(info.st_mode))
+    {
+        file = fopen(fileName, "wb");
+    }
+    else
+    {
+        tempName = (char*) malloc(strlen(fileName) + 64);
+        if (tempName != NULL)
+        {
+            pthread_mutex_lock(&tempNameLock);
+            tempNumber = numTempNames++;
+            pthread_mutex_unlock(&tempNameLock);
+            sprintf(tempName, "%s.%ld.%ld.tmp", fileName, (long) getpid(),
+                    tempNumber);
+            /* Never written over, in case another process named it */
+            descriptor = open(tempName, O_WRONLY | O_CREAT | O_EXCL, 0666);
+            if (descriptor >= 0)
+            {
+                file = fdopen(descriptor, "wb");
+                if (file == NULL)
+                {
+                    close(descriptor);
+                    remove(tempName);
+                }
+            }
+        }
+    }
+    if (file == NULL)
+    {
+        errNo = 1; /* File could not be opened */
+    }
+
+    if (errNo == 0 && fwrite(&header, sizeof(ProgramHeader), 1, file) != 1)
+    {
+        errNo = 3; /* System error */
+    }
+    for (ii = 0; ii < program->size && errNo == 0; ii += count)
+    {
+        count = normaliseValues(program, ii, batch);
+        if (fwrite(batch, sizeof(CommandValue), count, file) != (size_t) count)
+        {
+            errNo = 3; /* System error */
+        }
+    }
+    if (errNo == 0 &&
+        fwrite(program->opcodes, 1, program->size, file) != (size_t) program->size)
+    {
+        errNo = 3; /* System error */
+    }
+
+    if (file != NULL && fclose(file) != 0 && errNo == 0)
+    {
+        errNo = 2; /* Error closing file */
+    }
+    if (errNo == 0 && tempName != NULL && rename(tempName, fileName) != 0)
+    {
+        errNo = 1; /* File could not be renamed */
+    }
+    if (errNo != 0 && !isQuiet)
+    {
+        perror("ERROR: The compiled program could not be written");
+    }
+    if (errNo != 0 && file != NULL && tempName != NULL)
+    {
+        remove(tempName);
+    }
+    free(tempName);
+
+    return errNo;
+}
+
+/**
+ * A private function that copies up to WRITE_BATCH_SIZE values of a Program,
+ * starting from the given command, with the bytes each command does not use
+ * set to zero. Compiling the same file then always gives the same bytes.
+ *
+ * Parameters:
+ *  program - the Program to copy the values of
+ *  first   - the index of the first command to copy
+ *  batch   - (export) the normalised values
+ * Returns:
+ *  the number of values copied
+ */
+static int normaliseValues(Program* program, int first, CommandValue* batch)
+{
+    int ii, count, argType;
+
+    count = program->size - first;
+    if (count > WRITE_BATCH_SIZE)
+    {
+        count = WRITE_BATCH_SIZE;
+    }
+    memset(batch, 0, count * sizeof(CommandValue));
+    for (ii = 0; ii < count; ii++)
+    {
+        argType = getCommandInfo(program->opcodes[first + ii])->argType;
+        if (argType == REAL_ARG)
+        {
+            batch[ii].real = program->values[first + ii].real;
+        }
+        else if (argType == INT_ARG)
+        {
+            batch[ii].integer = program->values[first + ii].integer;
+        }
+        else if (argType == CHAR_ARG)
+        {
+            batch[ii].character = program->values[first + ii].character;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * A private function that finds the size, time of last change and hash of a
+ * text file, mapping it to hash it.
+ *
+ * Returns:
+ *  true(non-zero) on success, false(zero) if the file could not be read
+ */
+static int getSourceInfo(char* fileName, SourceInfo* source)
+{
+    FILE* file;
+    struct stat info;
+    void* map;
+    int isKnown = FALSE;
+
+    file = fopen(fileName, "rb");
+    if (file != NULL)
+    {
+        if (fstat(fileno(file), &info) == 0 && S_ISREG(info.st_mode))
+        {
+            source->size = (long) info.st_size;
+            source->time = (long) info.st_mtime;
+            source->hash = HASH_START;
+            isKnown = TRUE;
+            if (info.st_size > 0)
+            {
+                map = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE,
+                           fileno(file), 0);
+                if (map != MAP_FAILED)
+                {
+                    source->hash = hashBytes(HASH_START, map, (size_t) info.st_size);
+                    munmap(map, (size_t) info.st_size);
+                }
+                else
+                {
+                    isKnown = FALSE;
+                }
+            }
+        }
+        fclose(file);
+    }
+
+    return isKnown;
+}
+
+/**
+ * A private function that adds bytes to an FNV-1a hash, four bytes at a time
+ * with any left over added one at a time. Hashing a block in several pieces
+ * gives the same hash as long as each piece but the last is a multiple of four
+ * bytes long.
+ */
+static unsigned int hashBytes(unsigned int hash, const void* bytes, size_t length)
+{
+    const unsigned char* byte = (const unsigned char*) bytes;
+    unsigned int word;
+    size_t ii = 0;
+
+    for (ii = 0; ii + sizeof(unsigned int) <= length; ii += sizeof(unsigned int))
+    {
+        memcpy(&word, byte + ii, sizeof(unsigned int));
+        hash = (hash ^ word) * HASH_PRIME;
+    }
+    for (; ii < length; ii++)
+    {
+        hash = (hash ^ byte[ii]) * HASH_PRIME;
+    }
+
+    return hash;
+}
+
+/**
+ * A private function that checks a command read from a compiled file in the
+ * same way as a line of text would have been checked. Whether its REPEAT blocks
+ * match is checked afterwards.
+ *
+ * Returns:
+ *  true(non-zero) if the opcode exists and the value is valid for it
+ */
+static int isValidCommand(int opcode, CommandValue* value)
+{
+    int isValid;
+    const CommandInfo* info;
+
+    isValid = opcode >= 0 && opcode < NUM_COMMANDS;
+    if (isValid)
+    {
+        info = getCommandInfo(opcode);
+        if (info->argType == REAL_ARG)
+        {
+            isValid = value->real != HUGE_VAL && value->real != -HUGE_VAL;
+        }
+        else if (info->argType == INT_ARG)
+        {
+            isValid = !isOutOfBounds(opcode, value->integer, NULL, 0, NULL);
+        }
+        else if (info->argType == CHAR_ARG)
+        {
+            isValid = value->character != '\0' &&
+                      !isspace((unsigned char) value->character);
+        }
+    }
+
+    return isValid;
+}
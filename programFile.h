@@ -0,0 +1,48 @@
+#ifndef PROGRAMFILE_H
+#define PROGRAMFILE_H
+
+#include <stdio.h>
+#include "program.h"
+
+/* First bytes of every compiled program file */
+#define PROGRAM_MAGIC "TURTLEPG"
+#define PROGRAM_MAGIC_SIZE 8
+
+/* Version of the compiled format, changed whenever its layout changes */
+#define PROGRAM_VERSION 1
+
+/* Added to the name of a source file to name the compiled copy cached for it */
+#define CACHE_SUFFIX ".tgc"
+
+/**
+ * A struct representing the header at the start of a compiled program file.
+ * The header is followed by the values of the commands, then their opcodes,
+ * laid out exactly as in a Program in the byte order of the machine which wrote
+ * it, so the file can be mapped and executed in place. The checksum covers the
+ * values and opcodes. The source fields describe the text file it was compiled
+ * from, so a cached copy can be checked against it.
+ */
+typedef struct
+{
+    char magic[PROGRAM_MAGIC_SIZE];
+    unsigned int version;
+    unsigned int valueSize;
+    unsigned int byteOrder;
+    unsigned int checksum;
+    long numCommands;
+    long sourceSize;
+    long sourceTime;
+    unsigned int sourceHash;
+    unsigned int reserved;
+} ProgramHeader;
+
+int isProgramFile(char* fileName);
+
+int writeProgramFile(Program* program, char* fileName, char* sourceName);
+
+int readProgramFile(char* fileName, Program** program, FILE* errors);
+
+int readCommandsCached(char* fileName, Program** program, int numThreads,
+                       FILE* errors);
+
+#endif
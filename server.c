@@ -0,0 +1,679 @@
+/**
+ * Implementation of a drawing server, which keeps running and draws the
+ * commands sent to it over a Unix domain socket, so a drawing does not pay for
+ * starting the program. A fixed pool of threads each accept one connection at
+ * a time and draw it on a Canvas of their own, which is emptied for every
+ * request so it keeps the memory it has grown to. The tables built on first
+ * use are built before the first request is accepted.
+ *
+ * A request is a line naming the format of the frame, one of ansi, text, ppm,
+ * pgm or pbm, followed by commands in the same form as an input file, after
+ * which the client shuts down its side of the connection for writing. The
+ * whole request is received into a temporary file before it is read, and must
+ * arrive within REQUEST_TIMEOUT seconds and be at most MAX_REQUEST_SIZE bytes.
+ * Its drawing may execute at most MAX_REQUEST_COMMANDS commands, counting every
+ * repetition, so no request can keep a thread from the others for long. The
+ * response is a line holding the status and the number of bytes in the frame,
+ * followed by the frame itself: what the terminal would have been sent, the
+ * characters drawn as plain text, or the image. The status is the error code a
+ * run of its own would return, 12 if the drawing executes too many commands,
+ * or BAD_REQUEST, and no frame is sent unless it is 0. Each frame is drawn into
+ * a temporary file first, as the status is only known once it has been
+ * written.
+ *
+ * The server stops on SIGINT or SIGTERM, after finishing the requests it has
+ * accepted.
+ */
+
+/* Sockets, signals, pthreads and ftruncate are POSIX, not C89 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "boolean.h"
+#include "server.h"
+#include "utils.h"
+
+/* Number of bytes of a request or a frame copied at a time */
+#define COPY_SIZE 65536
+
+/* Number of seconds a client has to send the whole of a request */
+#define REQUEST_TIMEOUT 10
+
+/* Largest request accepted, in bytes */
+#define MAX_REQUEST_SIZE 16777216
+
+/* Most commands a request's drawing may execute, counting every repetition */
+#define MAX_REQUEST_COMMANDS 10000000L
+
+/* Number of formats a request can name */
+#define NUM_FORMATS 5
+
+/* Names of the formats a request can name, and the format of each */
+static const char* FORMAT_NAMES[NUM_FORMATS] = { "ansi", "text", "ppm", "pgm", "pbm" };
+static const int FORMATS[NUM_FORMATS] = { IMAGE_NONE, IMAGE_TEXT, IMAGE_PPM,
+                                          IMAGE_PGM, IMAGE_PBM };
+
+/**
+ * A struct representing the running server: the listening socket, the options
+ * every request is drawn with and the log file. The lock is held while adding
+ * to the log file and the statistics, and while reading or setting isClosing.
+ */
+typedef struct
+{
+    int socket;
+    Options* options;
+    FILE* logFile;
+    int isClosing;
+    pthread_mutex_t lock;
+} Server;
+
+/**
+ * A struct representing one thread of the server, with the Canvas it draws on
+ * and the temporary files it receives each request into and writes each frame
+ * and log to.
+ */
+typedef struct
+{
+    Server* server;
+    pthread_t thread;
+    Canvas* canvas;
+    FILE* request;
+    FILE* frame;
+    FILE* log;
+} Worker;
+
+static int openSocket(char* socketName);
+
+static void* Worker_run(void* data);
+
+static void Worker_serve(Worker* worker, int connection);
+
+static int Worker_receive(Worker* worker, int connection);
+
+static int Worker_draw(Worker* worker, LineReader* reader, int format);
+
+static int sendFrame(Worker* worker, int connection, int errNo);
+
+static int parseFormat(char* line, int length, int* format);
+
+static int sendAll(int connection, const char* bytes, size_t length);
+
+static int emptyFile(FILE* file);
+
+/**
+ * Listens for requests on a Unix domain socket and draws each of them, using
+ * one thread per processor unless --threads is given, until the program is
+ * interrupted or terminated. A socket left behind by an earlier server is
+ * replaced, and the socket is removed again when the server stops.
+ *
+ * Parameters:
+ *  socketName - the path of the socket to listen on
+ *  options    - the options given on the command line, used for every request
+ * Returns:
+ *  0 once stopped, 1 if the socket or the log file could not be opened, or 3
+ *  if the server could not be started
+ */
+int serveRequests(char* socketName, Options* options)
+{
+    int errNo;
+    Server server;
+    Worker workers[MAX_THREADS];
+    int numThreads, numStarted;
+    sigset_t signals;
+    int signalNumber;
+    double x, y;
+    char warmName[] = "MOVE";
+    int ii;
+
+    errNo = 0;
+    server.options = options;
+    server.isClosing = FALSE;
+    server.logFile = NULL;
+    server.socket = openSocket(socketName);
+    if (server.socket < 0)
+    {
+        errNo = 1; /* File could not be opened */
+    }
+    else
+    {
+        server.logFile = fopen(options->isBinaryLog ? BINARY_LOG_NAME : TEXT_LOG_NAME,
+                               options->isBinaryLog ? "ab" : "a");
+        if (server.logFile == NULL)
+        {
+            errNo = 1; /* File could not be opened */
+            perror("ERROR: The log file could not be opened");
+        }
+    }
+
+    if (errNo == 0 && pthread_mutex_init(&server.lock, NULL) == 0)
+    {
+        /* Build the tables used on first use now, not during a request */
+        unitVector(1.0, &x, &y);
+        getOpcode(warmName);
+        /* The hot path counters are shared, so are not kept */
+        stats.hasCounters = FALSE;
+
+        /* Every thread started from here waits for the signals here instead,
+         * and a client which goes away gives EPIPE instead of SIGPIPE */
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        sigaddset(&signals, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+        numThreads = getNumThreads(options->numThreads);
+        numStarted = 0;
+        for (ii = 0; ii < numThreads && numStarted == ii; ii++)
+        {
+            workers[ii].server = &server;
+            workers[ii].canvas = Canvas_create();
+            workers[ii].request = tmpfile();
+            workers[ii].frame = tmpfile();
+            workers[ii].log = tmpfile();
+            if (workers[ii].canvas != NULL && workers[ii].request != NULL &&
+                workers[ii].frame != NULL && workers[ii].log != NULL &&
+                pthread_create(&workers[ii].thread, NULL, &Worker_run,
+                               &workers[ii]) == 0)
+            {
+                numStarted++;
+            }
+            else
+            {
+                Canvas_free(workers[ii].canvas);
+                if (workers[ii].request != NULL)
+                {
+                    fclose(workers[ii].request);
+                }
+                if (workers[ii].frame != NULL)
+                {
+                    fclose(workers[ii].frame);
+                }
+                if (workers[ii].log != NULL)
+                {
+                    fclose(workers[ii].log);
+                }
+            }
+        }
+
+        if (numStarted > 0)
+        {
+            fprintf(stderr, "Serving on %s with %d threads.\n", socketName,
+                    numStarted);
+            sigdelset(&signals, SIGPIPE);
+            sigwait(&signals, &signalNumber);
+        }
+        else
+        {
+            errNo = 3; /* System error */
+            fprintf(stderr, "ERROR: Could not start the server.\n");
+        }
+
+        /* Wake the threads waiting for a connection, and let each finish the
+         * request it is drawing */
+        pthread_mutex_lock(&server.lock);
+        server.isClosing = TRUE;
+        pthread_mutex_unlock(&server.lock);
+        shutdown(server.socket, SHUT_RDWR);
+        for (ii = 0; ii < numStarted; ii++)
+        {
+            pthread_join(workers[ii].thread, NULL);
+            Canvas_free(workers[ii].canvas);
+            fclose(workers[ii].request);
+            fclose(workers[ii].frame);
+            fclose(workers[ii].log);
+        }
+        pthread_mutex_destroy(&server.lock);
+    }
+    else if (errNo == 0)
+    {
+        errNo = 3; /* System error */
+        fprintf(stderr, "ERROR: Could not start the server.\n");
+    }
+
+    if (server.socket >= 0)
+    {
+        close(server.socket);
+        unlink(socketName);
+    }
+    if (server.logFile != NULL && fclose(server.logFile) != 0)
+    {
+        perror("ERROR: The file was not closed successfully");
+    }
+
+    return errNo;
+}
+
+/**
+ * A private function that creates the socket, binds it to its path, replacing
+ * a socket left there but no other kind of file, and starts listening on it.
+ *
+ * Parameters:
+ *  socketName - the path of the socket
+ * Returns:
+ *  the socket, or -1 if it could not be opened
+ */
+static int openSocket(char* socketName)
+{
+    int listener = -1;
+    struct sockaddr_un address;
+    struct stat info;
+
+    if (strlen(socketName) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "ERROR: The socket name is too long.\n");
+    }
+    else
+    {
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strcpy(address.sun_path, socketName);
+
+        if (lstat(socketName, &info) == 0 && S_ISSOCK(info.st_mode))
+        {
+            unlink(socketName);
+        }
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0 ||
+            bind(listener, (struct sockaddr*) &address, sizeof(address)) != 0 ||
+            listen(listener, SOMAXCONN) != 0)
+        {
+            perror("ERROR: The socket could not be opened");
+            if (listener >= 0)
+            {
+                close(listener);
+                listener = -1;
+            }
+        }
+    }
+
+    return listener;
+}
+
+/**
+ * A private function run by each thread of the server, which accepts and
+ * serves one connection at a time until the server is closing.
+ *
+ * Parameters:
+ *  data - the Worker to run
+ * Returns:
+ *  NULL
+ */
+static void* Worker_run(void* data)
+{
+    Worker* worker = (Worker*) data;
+    Server* server = worker->server;
+    int connection;
+    int isClosing = FALSE;
+
+    while (!isClosing)
+    {
+        connection = accept(server->socket, NULL, NULL);
+        if (connection >= 0)
+        {
+            Worker_serve(worker, connection);
+            close(connection);
+        }
+
+        pthread_mutex_lock(&server->lock);
+        isClosing = server->isClosing;
+        pthread_mutex_unlock(&server->lock);
+        if (connection < 0 && !isClosing && errno != EINTR && errno != ECONNABORTED)
+        {
+            perror("ERROR: A request could not be accepted");
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * A private function that receives a request from a connection, draws it and
+ * sends back the response.
+ *
+ * Parameters:
+ *  worker     - the Worker serving the connection
+ *  connection - the connection to the client
+ */
+static void Worker_serve(Worker* worker, int connection)
+{
+    int errNo;
+    int input;
+    FILE* stream;
+    LineReader* reader;
+    char* line;
+    int length;
+    int format;
+
+    errNo = Worker_receive(worker, connection);
+    /* The request is read through a copy of its file, as closing the
+     * LineReader closes it */
+    reader = NULL;
+    stream = NULL;
+    if (errNo == 0)
+    {
+        input = dup(fileno(worker->request));
+        if (input >= 0)
+        {
+            stream = fdopen(input, "r");
+            if (stream == NULL)
+            {
+                close(input);
+            }
+        }
+        if (stream != NULL)
+        {
+            reader = LineReader_openStream(stream);
+        }
+        if (reader == NULL)
+        {
+            errNo = 3; /* System error */
+            fprintf(stderr, "ERROR: Could not allocate memory for the request.\n");
+        }
+    }
+
+    if (reader != NULL)
+    {
+        if (!LineReader_next(reader, &line, &length) ||
+            !parseFormat(line, length, &format))
+        {
+            errNo = BAD_REQUEST;
+            fprintf(stderr, "ERROR: The request does not start with the name of "
+                    "a format.\n");
+        }
+        else
+        {
+            errNo = Worker_draw(worker, reader, format);
+        }
+        LineReader_close(reader);
+    }
+
+    if (!sendFrame(worker, connection, errNo))
+    {
+        perror("ERROR: The response could not be sent");
+    }
+}
+
+/**
+ * A private function that receives the whole of a request into the Worker's
+ * request file, giving up when the client sends nothing for REQUEST_TIMEOUT
+ * seconds, takes longer than that overall, or sends more than
+ * MAX_REQUEST_SIZE bytes.
+ *
+ * Parameters:
+ *  worker     - the Worker serving the connection
+ *  connection - the connection to the client
+ * Returns:
+ *  0 on success, BAD_REQUEST if the request was too slow or too large, or 3 if
+ *  it could not be received
+ */
+static int Worker_receive(Worker* worker, int connection)
+{
+    int errNo = 0;
+    char buffer[COPY_SIZE];
+    struct timeval timeout;
+    double deadline;
+    long size, numRead;
+
+    timeout.tv_sec = REQUEST_TIMEOUT;
+    timeout.tv_usec = 0;
+    deadline = Stats_getTime() + REQUEST_TIMEOUT;
+    if (setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                   sizeof(timeout)) != 0 || !emptyFile(worker->request))
+    {
+        errNo = 3; /* System error */
+        perror("ERROR: The request could not be received");
+    }
+
+    size = 0;
+    numRead = 1;
+    while (errNo == 0 && numRead != 0)
+    {
+        numRead = (long) read(connection, buffer, COPY_SIZE);
+        if (numRead > 0)
+        {
+            size += numRead;
+            if (size > MAX_REQUEST_SIZE)
+            {
+                errNo = BAD_REQUEST;
+                fprintf(stderr, "ERROR: The request is larger than %d bytes.\n",
+                        MAX_REQUEST_SIZE);
+            }
+            else if (!sendAll(fileno(worker->request), buffer, (size_t) numRead))
+            {
+                errNo = 3; /* IO error */
+                perror("ERROR: The request could not be received");
+            }
+        }
+        else if (numRead < 0 && errno != EINTR && errno != EAGAIN &&
+                 errno != EWOULDBLOCK)
+        {
+            errNo = 3; /* IO error */
+            perror("ERROR: The request could not be received");
+        }
+
+        /* A read which timed out fails with EAGAIN, once the deadline is past */
+        if (errNo == 0 && numRead != 0 && Stats_getTime() >= deadline)
+        {
+            errNo = BAD_REQUEST;
+            fprintf(stderr, "ERROR: The request was not sent within %d seconds.\n",
+                    REQUEST_TIMEOUT);
+        }
+    }
+
+    return errNo;
+}
+
+/**
+ * A private function that reads the commands of a request and draws them into
+ * the Worker's frame file, the same way as a run of its own but reading and
+ * drawing with a single thread.
+ *
+ * Parameters:
+ *  worker - the Worker drawing the request
+ *  reader - the LineReader to read the commands from
+ *  format - IMAGE_NONE for the terminal's escape codes, or the format of the
+ *           image
+ * Returns:
+ *  the error code a run of its own would return, or 12 if the drawing executes
+ *  more than MAX_REQUEST_COMMANDS commands, please see readCommandsFromFile()
+ *  in fileIO.c for details
+ */
+static int Worker_draw(Worker* worker, LineReader* reader, int format)
+{
+    int errNo;
+    Server* server = worker->server;
+    Options options;
+    Stats runStats;
+    Sink sink;
+    Program* program;
+    double start;
+
+    options = *(server->options);
+    options.numThreads = 1;
+    options.maxExecuted = MAX_REQUEST_COMMANDS;
+    memset(&runStats, 0, sizeof(Stats));
+
+    start = Stats_getTime();
+    program = NULL;
+    errNo = readCommandsFromReader(reader, &program, options.numThreads, stderr);
+    if (errNo == 0 && options.optimiseLevel != OPTIMISE_OFF)
+    {
+        runStats.commandsRemoved = optimiseProgram(program, options.optimiseLevel);
+    }
+    runStats.times[PHASE_READ] = Stats_getTime() - start;
+
+    if (errNo == 0)
+    {
+        if (!emptyFile(worker->frame) || !emptyFile(worker->log))
+        {
+            errNo = 3; /* IO error */
+            perror("ERROR: The frame could not be written");
+        }
+    }
+    if (errNo == 0)
+    {
+        sink.output = worker->frame;
+        sink.format = format;
+        sink.logFile = worker->log;
+        sink.errors = stderr;
+        sink.stats = &runStats;
+        sink.canvas = worker->canvas;
+        errNo = executeCommands(program, NULL, &options, &sink);
+        if (fflush(worker->frame) != 0 && errNo == 0)
+        {
+            errNo = 3; /* IO error */
+            perror("ERROR: The frame could not be written");
+        }
+
+        pthread_mutex_lock(&server->lock);
+        if (!appendLog(server->logFile, worker->log))
+        {
+            perror("ERROR: The log could not be written");
+        }
+        if (options.statsFormat != STATS_OFF)
+        {
+            Stats_add(&runStats);
+        }
+        pthread_mutex_unlock(&server->lock);
+    }
+    Program_free(program);
+
+    return errNo;
+}
+
+/**
+ * A private function that sends the response to a request: the status line,
+ * followed by the frame when the status is 0.
+ *
+ * Parameters:
+ *  worker     - the Worker which drew the frame
+ *  connection - the connection to the client
+ *  errNo      - the status of the request
+ * Returns:
+ *  true(non-zero) on success, false(zero) if the response could not be sent
+ */
+static int sendFrame(Worker* worker, int connection, int errNo)
+{
+    char buffer[COPY_SIZE];
+    long frameSize;
+    long numRead;
+    int frame;
+    int isSent;
+
+    frame = fileno(worker->frame);
+    frameSize = 0;
+    if (errNo == 0)
+    {
+        frameSize = (long) lseek(frame, 0, SEEK_END);
+        if (frameSize < 0 || lseek(frame, 0, SEEK_SET) != 0)
+        {
+            errNo = 3; /* IO error */
+            frameSize = 0;
+        }
+    }
+
+    sprintf(buffer, "%d %ld\n", errNo, frameSize);
+    isSent = sendAll(connection, buffer, strlen(buffer));
+    while (isSent && frameSize > 0)
+    {
+        numRead = (long) read(frame, buffer, COPY_SIZE);
+        if (numRead > 0)
+        {
+            isSent = sendAll(connection, buffer, (size_t) numRead);
+            frameSize -= numRead;
+        }
+        else if (numRead == 0 || errno != EINTR)
+        {
+            isSent = FALSE;
+        }
+    }
+
+    return isSent;
+}
+
+/**
+ * A private function that finds the format named by the first line of a
+ * request. Whitespace after the name is ignored.
+ *
+ * Parameters:
+ *  line   - the first line of the request
+ *  length - the number of characters in the line
+ *  format - (export) IMAGE_NONE for ansi, or the format of the image
+ * Returns:
+ *  true(non-zero) if the line names a format, false(zero) otherwise
+ */
+static int parseFormat(char* line, int length, int* format)
+{
+    int ii;
+    int isFormat = FALSE;
+
+    while (length > 0 && (line[length - 1] == ' ' || line[length - 1] == '\t' ||
+                          line[length - 1] == '\r'))
+    {
+        length--;
+    }
+    for (ii = 0; ii < NUM_FORMATS && !isFormat; ii++)
+    {
+        if ((int) strlen(FORMAT_NAMES[ii]) == length &&
+            strncmp(line, FORMAT_NAMES[ii], length) == 0)
+        {
+            *format = FORMATS[ii];
+            isFormat = TRUE;
+        }
+    }
+
+    return isFormat;
+}
+
+/**
+ * A private function that writes all of the bytes to a connection, however
+ * many calls to write() it takes.
+ *
+ * Returns:
+ *  true(non-zero) on success, false(zero) if the connection could not be
+ *  written, with errno set by write()
+ */
+static int sendAll(int connection, const char* bytes, size_t length)
+{
+    size_t numWritten = 0;
+    long result;
+    int isWritten = TRUE;
+
+    while (numWritten < length && isWritten)
+    {
+        result = (long) write(connection, bytes + numWritten, length - numWritten);
+        if (result > 0)
+        {
+            numWritten += (size_t) result;
+        }
+        else if (result == 0 || errno != EINTR)
+        {
+            isWritten = FALSE;
+        }
+    }
+
+    return isWritten;
+}
+
+/**
+ * A private function that empties a temporary file so it can be written again
+ * from the start.
+ *
+ * Returns:
+ *  true(non-zero) on success, false(zero) otherwise, with errno set
+ */
+static int emptyFile(FILE* file)
+{
+    rewind(file);
+    return ftruncate(fileno(file), 0) == 0;
+}
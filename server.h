@@ -0,0 +1,12 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "turtleGraphics.h"
+
+/* Status sent back when a request does not name a format, is too large or is
+ * not sent in time */
+#define BAD_REQUEST 11
+
+int serveRequests(char* socketName, Options* options);
+
+#endif
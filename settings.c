@@ -1,23 +1,31 @@
 #include <stdlib.h>
 #include "settings.h"
+#include "utils.h"
 
 /**
  * Allocates enough memory for a TurtleSettings struct and initialises all fields
  * to their default values and returns the TurtleSettings struct.
  *
  * Returns:
- *  settings - a default TurtleSettings struct
+ *  settings - a default TurtleSettings struct, or NULL if the memory could not
+ *             be allocated
  */
 TurtleSettings* createSettings()
 {
     TurtleSettings* settings = (TurtleSettings*) malloc(sizeof(TurtleSettings));
 
-    settings->pos.x = 0;
-    settings->pos.y = 0;
-    settings->angle = 0.0;
-    settings->fgColour = WHITE_FG;
-    settings->bgColour = BLACK;
-    settings->pattern = '+';
+    if (settings != NULL)
+    {
+        settings->pos.x = 0;
+        settings->pos.y = 0;
+        settings->angle = 0.0;
+        settings->direction.x = 1.0;
+        settings->direction.y = 0.0;
+        settings->fgColour = WHITE_FG;
+        settings->bgColour = BLACK;
+        settings->pattern = '+';
+        settings->isBounded = TRUE;
+    }
 
     return settings;
 }
@@ -37,21 +45,47 @@ void getPos(TurtleSettings* settings, double* x, double* y)
     *y = settings->pos.y;
 }
 
+/**
+ * Checks whether the turtle can be at a position. Once it rounds to a cell off
+ * the top or left of the terminal, when bounded, or further than MAX_COORDINATE
+ * away, no more commands are executed.
+ *
+ * Parameters:
+ *  settings - the TurtleSettings struct which says whether it is bounded
+ *  x        - the x coordinate of the position
+ *  y        - the y coordinate of the position
+ * Returns:
+ *  true(non-zero) if the position is in bounds, false(zero) otherwise
+ */
+int isPositionValid(TurtleSettings* settings, double x, double y)
+{
+    double minimum = settings->isBounded ? 0.0 : -MAX_COORDINATE;
+
+    x = roundNum(x);
+    y = roundNum(y);
+
+    return x >= minimum && y >= minimum && x <= MAX_COORDINATE && y <= MAX_COORDINATE;
+}
+
 /**
  * Reset the foreground and background colours of the terminal to normal.
+ *
+ * Parameters:
+ *  terminal - the Terminal to write to
  */
-void resetColours()
+void resetColours(Terminal* terminal)
 {
-    setFgColour(WHITE_FG);
-    setBgColour(BLACK);
+    Terminal_setDefaultColours(terminal, WHITE_FG, BLACK);
 }
 
 /**
  * Set the foreground and background colours of the terminal so it's black
  * characters on a white background.
+ *
+ * Parameters:
+ *  terminal - the Terminal to write to
  */
-void setColoursSimple()
+void setColoursSimple(Terminal* terminal)
 {
-    setFgColour(BLACK);
-    setBgColour(WHITE_BG);
+    Terminal_setDefaultColours(terminal, BLACK, WHITE_BG);
 }
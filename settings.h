@@ -6,6 +6,8 @@
 #include "effects.h"
 #endif
 
+#include "terminal.h"
+
 #define MIN_COL_CODE 0
 #define MAX_FG_CODE 15
 #define MAX_BG_CODE 7
@@ -13,8 +15,15 @@
 #define WHITE_BG 7
 #define BLACK 0
 
+/* Furthest the turtle can go from the top left of the terminal in any
+ * direction, so every cell it reaches has an int row and column */
+#define MAX_COORDINATE 1000000000.0
+
 /**
- * A struct which keeps track of the current TurtleGraphics options
+ * A struct which keeps track of the current TurtleGraphics options. The
+ * direction is the unit vector of the angle, which only changes on a ROTATE.
+ * While the drawing is bounded the turtle cannot go above or left of the top
+ * left of the terminal.
  */
 typedef struct
 {
@@ -24,17 +33,25 @@ typedef struct
         double y;
     } pos;
     double angle;
+    struct
+    {
+        double x;
+        double y;
+    } direction;
     int fgColour;
     int bgColour;
     char pattern;
+    int isBounded;
 } TurtleSettings;
 
 TurtleSettings* createSettings();
 
 void getPos(TurtleSettings* settings, double* x, double* y);
 
-void resetColours();
+int isPositionValid(TurtleSettings* settings, double x, double y);
+
+void resetColours(Terminal* terminal);
 
-void setColoursSimple();
+void setColoursSimple(Terminal* terminal);
 
 #endif
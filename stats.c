@@ -0,0 +1,165 @@
+/**
+ * Implementation of the run statistics printed by --stats and --stats-json.
+ */
+
+/* clock_gettime is POSIX, not C89 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <time.h>
+#include "boolean.h"
+#include "stats.h"
+
+/* Names of the phases, indexed by phase */
+static const char* PHASE_NAMES[NUM_PHASES] =
+{
+    "read", "execute", "output", "total"
+};
+
+/* The statistics of this run, all zero to begin with */
+Stats stats;
+
+static void printCounter(FILE* stream, int format, const char* jsonName,
+                         const char* textName, long value, int isCounted);
+
+/**
+ * Returns the time in seconds from an arbitrary point, using a clock which is
+ * not affected by changes to the system time.
+ */
+double Stats_getTime()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+/**
+ * Adds the statistics of one drawing of a batch to those of the whole batch.
+ * The times of each phase are added up, so they may come to more than the total
+ * when the drawings run at once, and the peak number of commands is the largest
+ * of any drawing. Only one thread may add at a time.
+ *
+ * Parameters:
+ *  run - the statistics of the drawing
+ */
+void Stats_add(Stats* run)
+{
+    int ii;
+
+    for (ii = 0; ii < PHASE_TOTAL; ii++)
+    {
+        stats.times[ii] += run->times[ii];
+    }
+    for (ii = 0; ii < NUM_COMMANDS; ii++)
+    {
+        stats.commands[ii] += run->commands[ii];
+    }
+    stats.escapeBytes += run->escapeBytes;
+    stats.allocations += run->allocations;
+    stats.arenaBlocks += run->arenaBlocks;
+    if (run->peakCommands > stats.peakCommands)
+    {
+        stats.peakCommands = run->peakCommands;
+    }
+    stats.commandsRemoved += run->commandsRemoved;
+}
+
+/**
+ * Prints the statistics as a table, or as a single line of JSON. Counters which
+ * this build does not keep are shown as "-" in the table and null in JSON; only
+ * TurtleGraphicsStats keeps the cells plotted and the polToRec calls.
+ *
+ * Parameters:
+ *  stream - the FILE pointer to print to
+ *  format - STATS_TEXT or STATS_JSON
+ */
+void Stats_print(FILE* stream, int format)
+{
+    int ii;
+
+    if (format == STATS_JSON)
+    {
+        fprintf(stream, "{\"times\":{");
+        for (ii = 0; ii < NUM_PHASES; ii++)
+        {
+            fprintf(stream, "%s\"%s\":%.6f", ii == 0 ? "" : ",", PHASE_NAMES[ii],
+                    stats.times[ii]);
+        }
+        fprintf(stream, "},\"commands\":{");
+        for (ii = 0; ii < NUM_COMMANDS; ii++)
+        {
+            fprintf(stream, "%s\"%s\":%ld", ii == 0 ? "" : ",",
+                    getCommandInfo(ii)->name, stats.commands[ii]);
+        }
+        fprintf(stream, "}");
+    }
+    else
+    {
+        fprintf(stream, "Statistics:\n");
+        for (ii = 0; ii < NUM_PHASES; ii++)
+        {
+            fprintf(stream, "  %-16s %12.6f s\n", PHASE_NAMES[ii], stats.times[ii]);
+        }
+        for (ii = 0; ii < NUM_COMMANDS; ii++)
+        {
+            fprintf(stream, "  %-16s %12ld\n", getCommandInfo(ii)->name,
+                    stats.commands[ii]);
+        }
+    }
+
+    printCounter(stream, format, "cellsPlotted", "cells plotted",
+                 stats.cellsPlotted, stats.hasCounters);
+    printCounter(stream, format, "polToRecCalls", "polToRec calls",
+                 stats.polToRecCalls, stats.hasCounters);
+    printCounter(stream, format, "escapeBytes", "escape bytes",
+                 stats.escapeBytes, TRUE);
+    printCounter(stream, format, "allocations", "allocations",
+                 stats.allocations, TRUE);
+    printCounter(stream, format, "arenaBlocks", "arena blocks",
+                 stats.arenaBlocks, TRUE);
+    printCounter(stream, format, "peakCommands", "peak commands",
+                 stats.peakCommands, TRUE);
+    printCounter(stream, format, "commandsRemoved", "commands removed",
+                 stats.commandsRemoved, TRUE);
+
+    if (format == STATS_JSON)
+    {
+        fprintf(stream, "}\n");
+    }
+}
+
+/**
+ * A private function that prints one counter as a member of the JSON object or
+ * as a row of the table.
+ *
+ * Parameters:
+ *  stream    - the FILE pointer to print to
+ *  format    - STATS_TEXT or STATS_JSON
+ *  jsonName  - the name of the counter in JSON
+ *  textName  - the name of the counter in the table
+ *  value     - the value of the counter
+ *  isCounted - false(zero) if the counter is not kept by this build
+ */
+static void printCounter(FILE* stream, int format, const char* jsonName,
+                         const char* textName, long value, int isCounted)
+{
+    if (format == STATS_JSON)
+    {
+        if (isCounted)
+        {
+            fprintf(stream, ",\"%s\":%ld", jsonName, value);
+        }
+        else
+        {
+            fprintf(stream, ",\"%s\":null", jsonName);
+        }
+    }
+    else if (isCounted)
+    {
+        fprintf(stream, "  %-16s %12ld\n", textName, value);
+    }
+    else
+    {
+        fprintf(stream, "  %-16s %12s\n", textName, "-");
+    }
+}
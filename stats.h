@@ -0,0 +1,58 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include "command.h"
+
+/* Formats the statistics can be printed in */
+#define STATS_OFF 0
+#define STATS_TEXT 1
+#define STATS_JSON 2
+
+/* The phases of a run which are timed */
+#define PHASE_READ 0
+#define PHASE_EXECUTE 1
+#define PHASE_OUTPUT 2
+#define PHASE_TOTAL 3
+#define NUM_PHASES 4
+
+/* Counters on the hot paths are only kept when compiled with -DSTATS=1, as in
+ * TurtleGraphicsStats, so they cost nothing in the other builds. They are also
+ * left alone while hasCounters is cleared, as it is when several drawings run
+ * at once */
+#ifdef STATS
+#define STATS_COUNT(counter, amount) \
+    ((void) (stats.hasCounters ? (stats.counter += (amount)) : 0))
+#else
+#define STATS_COUNT(counter, amount)
+#endif
+
+/**
+ * A struct which holds the statistics of a run: the seconds spent in each
+ * phase, the number of each command executed, and counters of the work done.
+ * The hot path counters are only valid when hasCounters is set.
+ */
+typedef struct
+{
+    double times[NUM_PHASES];
+    long commands[NUM_COMMANDS];
+    int hasCounters;
+    long cellsPlotted;
+    long polToRecCalls;
+    long escapeBytes;
+    long allocations;
+    long arenaBlocks;
+    long peakCommands;
+    long commandsRemoved;
+} Stats;
+
+/* The statistics of this run */
+extern Stats stats;
+
+double Stats_getTime();
+
+void Stats_add(Stats* run);
+
+void Stats_print(FILE* stream, int format);
+
+#endif
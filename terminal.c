@@ -0,0 +1,420 @@
+/**
+ * Implementation of a buffered terminal writer. It keeps track of where the
+ * terminal's cursor really is and which colours it is using, so each move is
+ * written in the fewest bytes and colours are only changed when they differ.
+ * Everything is kept in one large buffer, which is written with a single call
+ * to write() each time the Terminal is flushed, normally once per frame.
+ */
+
+/* write, fileno, isatty and ioctl are POSIX, not C89 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include "boolean.h"
+#include "terminal.h"
+
+/* Number of bytes the buffer starts with, which it doubles from when full */
+#define INITIAL_CAPACITY 65536
+
+/* More than the longest move or colour change, e.g. "\033[10000;10000H" */
+#define MAX_ESCAPE_SIZE 32
+
+/* Column of a cursor which is not known to be anywhere */
+#define UNKNOWN_POSITION -1
+
+/**
+ * A struct representing a terminal being written to. The cursor is at column x
+ * and row y, from zero, unless x is UNKNOWN_POSITION, as it is before the first
+ * move and after a character is written in the last column. The width and
+ * height are INT_MAX unless the stream is a terminal which gave its size.
+ */
+struct Terminal
+{
+    FILE* stream;
+    char* buffer;
+    size_t size;
+    size_t capacity;
+    int width;
+    int height;
+    int x;
+    int y;
+    int fgColour;
+    int bgColour;
+};
+
+static void Terminal_append(Terminal* terminal, const char* bytes, int length);
+
+static int formatMove(char* escape, int distance, char direction);
+
+/**
+ * Allocates a Terminal which writes to a stream, with an empty buffer. The
+ * size of the terminal is asked for when the stream is one.
+ *
+ * Parameters:
+ *  stream - the FILE pointer to write to, normally stdout
+ * Returns:
+ *  terminal - the Terminal, or NULL if the memory could not be allocated
+ */
+Terminal* Terminal_create(FILE* stream)
+{
+    Terminal* terminal = (Terminal*) malloc(sizeof(Terminal));
+    struct winsize size;
+
+    if (terminal != NULL)
+    {
+        terminal->buffer = (char*) malloc(INITIAL_CAPACITY);
+        if (terminal->buffer == NULL)
+        {
+            free(terminal);
+            terminal = NULL;
+        }
+    }
+    if (terminal != NULL)
+    {
+        terminal->stream = stream;
+        terminal->size = 0;
+        terminal->capacity = INITIAL_CAPACITY;
+        terminal->width = INT_MAX;
+        terminal->height = INT_MAX;
+        if (isatty(fileno(stream)) &&
+            ioctl(fileno(stream), TIOCGWINSZ, &size) == 0 &&
+            size.ws_col > 0 && size.ws_row > 0)
+        {
+            terminal->width = size.ws_col;
+            terminal->height = size.ws_row;
+        }
+        terminal->x = UNKNOWN_POSITION;
+        terminal->y = 0;
+        /* Nothing has changed the terminal's colours before it is first
+         * written */
+        terminal->fgColour = DEFAULT_COLOUR;
+        terminal->bgColour = DEFAULT_COLOUR;
+    }
+
+    return terminal;
+}
+
+/**
+ * Moves the cursor to a cell using the shortest of: nothing when it is already
+ * there, moving forward (CUF), moving down (CUD) then forward, a carriage
+ * return then line feeds or CUD then forward, or moving to the cell directly.
+ * Relative moves are only used while the cursor is known to be on the screen
+ * and the cell is below or right of it, so they end up in the same place as
+ * moving directly; line feeds are only used when the height of the terminal is
+ * known, so they never scroll it.
+ *
+ * Parameters:
+ *  terminal - the Terminal to write to
+ *  x        - the column to move to, starting from zero
+ *  y        - the row to move to, starting from zero
+ * Returns:
+ *  the number of bytes written
+ */
+int Terminal_moveTo(Terminal* terminal, int x, int y)
+{
+    char best[MAX_ESCAPE_SIZE];
+    char move[MAX_ESCAPE_SIZE];
+    int bestLength, length, down;
+
+    bestLength = 0;
+    if (terminal->x != x || terminal->y != y)
+    {
+        /* Move to row y + 1, column x + 1 */
+        bestLength = sprintf(best, "\033[%d;%dH", y + 1, x + 1);
+
+        if (terminal->x != UNKNOWN_POSITION && y >= terminal->y &&
+            x < terminal->width && y < terminal->height)
+        {
+            down = y - terminal->y;
+            if (x >= terminal->x)
+            {
+                length = formatMove(move, down, 'B');
+                length += formatMove(move + length, x - terminal->x, 'C');
+                if (length < bestLength)
+                {
+                    memcpy(best, move, length);
+                    bestLength = length;
+                }
+            }
+
+            move[0] = '\r';
+            length = 1 + formatMove(move + 1, down, 'B');
+            if (terminal->height != INT_MAX && down < length - 1)
+            {
+                /* A few line feeds are shorter than CUD */
+                memset(move + 1, '\n', down);
+                length = 1 + down;
+            }
+            length += formatMove(move + length, x, 'C');
+            if (length < bestLength)
+            {
+                memcpy(best, move, length);
+                bestLength = length;
+            }
+        }
+
+        Terminal_append(terminal, best, bestLength);
+        terminal->x = x;
+        terminal->y = y;
+        if (x >= terminal->width || y >= terminal->height)
+        {
+            /* The cursor stopped at the edge of the terminal */
+            terminal->x = UNKNOWN_POSITION;
+        }
+    }
+
+    return bestLength;
+}
+
+/**
+ * Writes the escape code needed to change the terminal's colours to the given
+ * ones, which is nothing when they are the same. Otherwise a single SGR code is
+ * written with only the parameters which change: bold on (1) or off (22), the
+ * foreground colour (30-37, or 39 for the default) and the background colour
+ * (40-47, or 49 for the default). Codes 8-15 are the bold versions of 0-7, as
+ * with setFgColour().
+ *
+ * Parameters:
+ *  terminal - the Terminal to write to
+ *  fgColour - the foreground colour (0-15), or DEFAULT_COLOUR
+ *  bgColour - the background colour (0-7), or DEFAULT_COLOUR
+ * Returns:
+ *  the number of bytes written
+ */
+int Terminal_setColours(Terminal* terminal, int fgColour, int bgColour)
+{
+    char escape[MAX_ESCAPE_SIZE];
+    int length = 0;
+    int isBold, wasBold;
+
+    if (fgColour != terminal->fgColour || bgColour != terminal->bgColour)
+    {
+        length = sprintf(escape, "\033[");
+        if (fgColour != terminal->fgColour)
+        {
+            isBold = fgColour != DEFAULT_COLOUR && (fgColour % 16) >= 8;
+            wasBold = terminal->fgColour != DEFAULT_COLOUR &&
+                      (terminal->fgColour % 16) >= 8;
+            if (isBold != wasBold)
+            {
+                length += sprintf(escape + length, isBold ? "1;" : "22;");
+            }
+            if (fgColour == DEFAULT_COLOUR)
+            {
+                length += sprintf(escape + length, "39;");
+            }
+            else if (terminal->fgColour == DEFAULT_COLOUR ||
+                     fgColour % 8 != terminal->fgColour % 8)
+            {
+                length += sprintf(escape + length, "%d;", (fgColour % 8) + 30);
+            }
+            terminal->fgColour = fgColour;
+        }
+        if (bgColour != terminal->bgColour)
+        {
+            if (bgColour == DEFAULT_COLOUR)
+            {
+                length += sprintf(escape + length, "49;");
+            }
+            else
+            {
+                length += sprintf(escape + length, "%d;", (bgColour % 8) + 40);
+            }
+            terminal->bgColour = bgColour;
+        }
+        /* The last parameter's ';' ends the code instead */
+        escape[length - 1] = 'm';
+        Terminal_append(terminal, escape, length);
+    }
+
+    return length;
+}
+
+/**
+ * Changes the terminal's own colours, which cells of DEFAULT_COLOUR are then
+ * drawn in. The same escape codes as setFgColour() and setBgColour() are
+ * written, so codes 8-15 turn bold on.
+ *
+ * Parameters:
+ *  terminal - the Terminal to write to
+ *  fgColour - the foreground colour (0-15)
+ *  bgColour - the background colour (0-7)
+ */
+void Terminal_setDefaultColours(Terminal* terminal, int fgColour, int bgColour)
+{
+    char escape[MAX_ESCAPE_SIZE];
+    int length;
+
+    length = sprintf(escape, "\033[22;%dm", (fgColour % 8) + 30);
+    if ((fgColour % 16) >= 8)
+    {
+        length += sprintf(escape + length, "\033[1m");
+    }
+    length += sprintf(escape + length, "\033[%dm", (bgColour % 8) + 40);
+    Terminal_append(terminal, escape, length);
+    terminal->fgColour = DEFAULT_COLOUR;
+    terminal->bgColour = DEFAULT_COLOUR;
+}
+
+/**
+ * Writes a character at the cursor, which moves the cursor one column right.
+ */
+void Terminal_putChar(Terminal* terminal, char c)
+{
+    if (terminal->size < terminal->capacity)
+    {
+        terminal->buffer[terminal->size] = c;
+        (terminal->size)++;
+    }
+    else
+    {
+        Terminal_append(terminal, &c, 1);
+    }
+
+    if (terminal->x != UNKNOWN_POSITION)
+    {
+        (terminal->x)++;
+        if (terminal->x >= terminal->width)
+        {
+            /* The cursor waits in the last column for the next character */
+            terminal->x = UNKNOWN_POSITION;
+        }
+    }
+}
+
+/**
+ * Clears the whole terminal, as clearScreen() does, leaving the cursor where it
+ * is.
+ *
+ * Parameters:
+ *  terminal - the Terminal to clear
+ */
+void Terminal_clear(Terminal* terminal)
+{
+    Terminal_append(terminal, "\033[2J", 4);
+}
+
+/**
+ * Moves the cursor to the start of the last row, below anything drawn, as
+ * penDown() does.
+ *
+ * Parameters:
+ *  terminal - the Terminal to write to
+ */
+void Terminal_moveBelow(Terminal* terminal)
+{
+    Terminal_append(terminal, "\033[10000;1H", 10);
+    terminal->x = UNKNOWN_POSITION;
+}
+
+/**
+ * Writes everything in the buffer to the stream with a single call to write(),
+ * unless the call is interrupted or only part of the buffer fits, and empties
+ * the buffer. Anything already printed to the stream is flushed first so it is
+ * not written out of order.
+ *
+ * Parameters:
+ *  terminal - the Terminal to flush
+ * Returns:
+ *  true(non-zero) on success, false(zero) if the stream could not be written,
+ *  with errno set by write()
+ */
+int Terminal_flush(Terminal* terminal)
+{
+    size_t numWritten = 0;
+    long result;
+    int isWritten = TRUE;
+
+    fflush(terminal->stream);
+    while (numWritten < terminal->size && isWritten)
+    {
+        result = (long) write(fileno(terminal->stream),
+                              terminal->buffer + numWritten,
+                              terminal->size - numWritten);
+        if (result > 0)
+        {
+            numWritten += (size_t) result;
+        }
+        else if (result == 0 || errno != EINTR)
+        {
+            isWritten = FALSE;
+        }
+    }
+    terminal->size = 0;
+
+    return isWritten;
+}
+
+/**
+ * Frees the memory allocated to a Terminal, without flushing it or closing its
+ * stream.
+ *
+ * Parameters:
+ *  terminal - the Terminal to free
+ */
+void Terminal_free(Terminal* terminal)
+{
+    if (terminal != NULL)
+    {
+        free(terminal->buffer);
+        free(terminal);
+    }
+}
+
+/**
+ * A private function that adds bytes to the end of the buffer, doubling it when
+ * they do not fit. If there is not enough memory to double it, the buffer is
+ * flushed early to make room instead.
+ */
+static void Terminal_append(Terminal* terminal, const char* bytes, int length)
+{
+    char* buffer;
+
+    if (terminal->size + length > terminal->capacity)
+    {
+        buffer = (char*) realloc(terminal->buffer, terminal->capacity * 2);
+        if (buffer != NULL)
+        {
+            terminal->buffer = buffer;
+            terminal->capacity *= 2;
+        }
+        else
+        {
+            Terminal_flush(terminal);
+        }
+    }
+    memcpy(terminal->buffer + terminal->size, bytes, length);
+    terminal->size += length;
+}
+
+/**
+ * A private function that formats a relative cursor movement, leaving out the
+ * distance when it is one as that is the default.
+ *
+ * Parameters:
+ *  escape    - (export) where to write the escape code
+ *  distance  - the number of cells to move, where zero writes nothing
+ *  direction - 'B' to move down or 'C' to move right
+ * Returns:
+ *  the number of bytes written
+ */
+static int formatMove(char* escape, int distance, char direction)
+{
+    int length = 0;
+
+    if (distance == 1)
+    {
+        length = sprintf(escape, "\033[%c", direction);
+    }
+    else if (distance > 1)
+    {
+        length = sprintf(escape, "\033[%d%c", distance, direction);
+    }
+
+    return length;
+}
@@ -0,0 +1,32 @@
+#ifndef TERMINAL_H
+#define TERMINAL_H
+
+#include <stdio.h>
+
+/* Colour code used for a cell drawn before any FG or BG command, i.e. the
+ * terminal's own default colour */
+#define DEFAULT_COLOUR -1
+
+/* The Terminal is private to terminal.c, as it must know where the cursor is
+ * to move it */
+typedef struct Terminal Terminal;
+
+Terminal* Terminal_create(FILE* stream);
+
+int Terminal_moveTo(Terminal* terminal, int x, int y);
+
+int Terminal_setColours(Terminal* terminal, int fgColour, int bgColour);
+
+void Terminal_setDefaultColours(Terminal* terminal, int fgColour, int bgColour);
+
+void Terminal_putChar(Terminal* terminal, char c);
+
+void Terminal_clear(Terminal* terminal);
+
+void Terminal_moveBelow(Terminal* terminal);
+
+int Terminal_flush(Terminal* terminal);
+
+void Terminal_free(Terminal* terminal);
+
+#endif
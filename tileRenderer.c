@@ -0,0 +1,670 @@
+/**
+ * Implementation of a renderer which draws batches of lines on a canvas with
+ * several threads. The canvas is split into tiles, bands of TILE_HEIGHT rows
+ * which each hold whole rows, and every line is added to the list of each tile
+ * its rows pass through. The threads take tiles one at a time until none are
+ * left, and each draws only its tile's rows of its lines, in the order the
+ * lines were added. As every cell belongs to one tile, the last line over a
+ * cell still wins and the canvas ends up exactly as if the lines were drawn one
+ * after the other with Canvas_drawLine(). The bands start from the top of each
+ * batch and are a whole number of canvas tiles high, so no canvas tile is
+ * shared by two threads.
+ */
+
+/* pthreads are POSIX, not C89 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "boolean.h"
+#include "tileRenderer.h"
+#include "utils.h"
+#include "stats.h"
+
+/* Number of lines held before they are drawn */
+#define SEGMENT_CAPACITY 4096
+
+/* Number of rows in each tile, a multiple of CANVAS_TILE_SIZE, and the most
+ * tiles a batch can have. Batches reaching over more rows than that are drawn
+ * by the calling thread alone */
+#define TILE_HEIGHT 64
+#define MAX_TILES ((MAX_CANVAS_SIZE + TILE_HEIGHT - 1) / TILE_HEIGHT)
+
+/* Fewest cells a batch of lines must cover before it is worth waking the
+ * other threads, smaller batches are drawn by the calling thread alone */
+#define MIN_PARALLEL_CELLS 16384
+
+/**
+ * A struct representing one tile of a batch: its rows, the lines passing
+ * through it, the number of cells its thread plotted, and the canvas tile it
+ * plotted last.
+ */
+typedef struct
+{
+    int top;
+    int bottom;
+    int first;
+    int last;
+    long numCells;
+    CanvasTile* canvasTile;
+} Tile;
+
+/**
+ * A struct representing a line being drawn in one tile, handed to plotCell()
+ * with each of its cells.
+ */
+typedef struct
+{
+    TileRenderer* renderer;
+    Tile* tile;
+    Cell* pen;
+} TilePen;
+
+/**
+ * A struct representing the renderer. The lines are held in 'segments' until
+ * they are drawn. 'binned' holds the indexes of each tile's lines, with tile
+ * 'ii' using binned[tiles[ii].first] to binned[tiles[ii].last - 1]. The threads
+ * wait on 'started' for the generation to change, take tiles by 'nextTile'
+ * under the lock, and the last one to finish signals 'finished'. Canvas tiles
+ * are only looked up under 'growLock', as they share the canvas's hash table
+ * and Arena.
+ */
+struct TileRenderer
+{
+    Segment* segments;
+    int numSegments;
+    int* binned;
+    int binCapacity;
+    Tile tiles[MAX_TILES];
+    int numTiles;
+    Canvas* canvas;
+    int nextTile;
+    int numThreads;
+    int numBusy;
+    int generation;
+    int isClosing;
+    int isThreaded;
+    pthread_t threads[MAX_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t started;
+    pthread_cond_t finished;
+    pthread_mutex_t growLock;
+};
+
+static void* TileRenderer_run(void* data);
+
+static int binSegments(TileRenderer* renderer, Canvas* canvas);
+
+static int getRows(Canvas* canvas, Segment* segment, int* top, int* bottom,
+                   int* numCells);
+
+static void drawTiles(TileRenderer* renderer);
+
+static void drawSegment(TileRenderer* renderer, Tile* tile, Segment* segment);
+
+static void plotCell(int x, int y, void* tilePen);
+
+static void plotSpan(TileRenderer* renderer, Tile* tile, int y, int left,
+                     int right, Cell* pen);
+
+static CanvasTile* getCanvasTile(TileRenderer* renderer, Tile* tile, int x, int y);
+
+/**
+ * Creates a TileRenderer and starts its threads. The calling thread draws tiles
+ * as well, so one fewer thread is started than asked for. If a thread cannot be
+ * started the renderer carries on with those it has, down to drawing every line
+ * in the calling thread.
+ *
+ * Parameters:
+ *  numThreads - the number of threads to draw with, or zero for one per
+ *               processor, at most MAX_THREADS
+ * Returns:
+ *  renderer - the TileRenderer, or NULL if the memory could not be allocated
+ */
+TileRenderer* TileRenderer_create(int numThreads)
+{
+    TileRenderer* renderer = (TileRenderer*) malloc(sizeof(TileRenderer));
+    int ii;
+
+    numThreads = getNumThreads(numThreads);
+    if (renderer != NULL)
+    {
+        renderer->segments = (Segment*) malloc(SEGMENT_CAPACITY * sizeof(Segment));
+        if (renderer->segments != NULL)
+        {
+            renderer->numSegments = 0;
+            renderer->binned = NULL;
+            renderer->binCapacity = 0;
+            renderer->numTiles = 0;
+            renderer->canvas = NULL;
+            renderer->nextTile = 0;
+            renderer->numBusy = 0;
+            renderer->generation = 0;
+            renderer->isClosing = FALSE;
+
+            renderer->numThreads = 1;
+            renderer->isThreaded = numThreads > 1 &&
+                pthread_mutex_init(&renderer->lock, NULL) == 0;
+            if (renderer->isThreaded)
+            {
+                renderer->isThreaded =
+                    pthread_cond_init(&renderer->started, NULL) == 0 &&
+                    pthread_cond_init(&renderer->finished, NULL) == 0 &&
+                    pthread_mutex_init(&renderer->growLock, NULL) == 0;
+            }
+            for (ii = 1; ii < numThreads && renderer->isThreaded &&
+                         ii == renderer->numThreads; ii++)
+            {
+                if (pthread_create(&renderer->threads[ii - 1], NULL,
+                                   &TileRenderer_run, renderer) == 0)
+                {
+                    renderer->numThreads++;
+                }
+            }
+        }
+        else
+        {
+            free(renderer);
+            renderer = NULL;
+        }
+    }
+
+    return renderer;
+}
+
+/**
+ * Adds a line to be drawn with the canvas's current pen. The line is drawn by
+ * the next TileRenderer_flush(), which happens here when the renderer is full.
+ *
+ * Parameters:
+ *  renderer - the TileRenderer to add the line to
+ *  canvas   - the Canvas the line is drawn on
+ *  x1       - the column the line starts from
+ *  y1       - the row the line starts from
+ *  x2       - the column the line ends at
+ *  y2       - the row the line ends at
+ */
+void TileRenderer_add(TileRenderer* renderer, Canvas* canvas, int x1, int y1,
+                      int x2, int y2)
+{
+    Segment* segment;
+
+    if (renderer->numSegments == SEGMENT_CAPACITY)
+    {
+        TileRenderer_flush(renderer, canvas);
+    }
+
+    segment = &(renderer->segments[renderer->numSegments]);
+    segment->x1 = x1;
+    segment->y1 = y1;
+    segment->x2 = x2;
+    segment->y2 = y2;
+    segment->pen = canvas->pen;
+    renderer->numSegments++;
+}
+
+/**
+ * Draws every line added since the last flush onto the canvas. Batches of lines
+ * covering enough cells are split into tiles and drawn by all the threads,
+ * while smaller ones are drawn in the calling thread. Either way the canvas
+ * ends up the same, and its pen is left as it was.
+ */
+void TileRenderer_flush(TileRenderer* renderer, Canvas* canvas)
+{
+    int ii;
+    Cell pen;
+    Segment* segment;
+
+    if (renderer->numSegments > 0)
+    {
+        if (renderer->numThreads > 1 && binSegments(renderer, canvas))
+        {
+            /* Wake the threads and draw alongside them */
+            pthread_mutex_lock(&renderer->lock);
+            renderer->canvas = canvas;
+            renderer->nextTile = 0;
+            renderer->numBusy = renderer->numThreads - 1;
+            renderer->generation++;
+            pthread_cond_broadcast(&renderer->started);
+            pthread_mutex_unlock(&renderer->lock);
+
+            drawTiles(renderer);
+
+            pthread_mutex_lock(&renderer->lock);
+            while (renderer->numBusy > 0)
+            {
+                pthread_cond_wait(&renderer->finished, &renderer->lock);
+            }
+            pthread_mutex_unlock(&renderer->lock);
+
+            for (ii = 0; ii < renderer->numTiles; ii++)
+            {
+                STATS_COUNT(cellsPlotted, renderer->tiles[ii].numCells);
+            }
+        }
+        else
+        {
+            pen = canvas->pen;
+            for (ii = 0; ii < renderer->numSegments; ii++)
+            {
+                segment = &(renderer->segments[ii]);
+                canvas->pen = segment->pen;
+                Canvas_drawLine(canvas, segment->x1, segment->y1, segment->x2,
+                                segment->y2);
+            }
+            canvas->pen = pen;
+        }
+        renderer->numSegments = 0;
+    }
+}
+
+/**
+ * Stops the threads and frees the TileRenderer. Any lines not yet flushed are
+ * dropped.
+ */
+void TileRenderer_free(TileRenderer* renderer)
+{
+    int ii;
+
+    if (renderer != NULL)
+    {
+        if (renderer->isThreaded)
+        {
+            pthread_mutex_lock(&renderer->lock);
+            renderer->isClosing = TRUE;
+            pthread_cond_broadcast(&renderer->started);
+            pthread_mutex_unlock(&renderer->lock);
+            for (ii = 0; ii < renderer->numThreads - 1; ii++)
+            {
+                pthread_join(renderer->threads[ii], NULL);
+            }
+            pthread_mutex_destroy(&renderer->growLock);
+            pthread_cond_destroy(&renderer->finished);
+            pthread_cond_destroy(&renderer->started);
+            pthread_mutex_destroy(&renderer->lock);
+        }
+        free(renderer->binned);
+        free(renderer->segments);
+        free(renderer);
+    }
+}
+
+/**
+ * A private function that is run by each of the renderer's threads. It draws
+ * tiles every time the generation changes, until the renderer is closed.
+ */
+static void* TileRenderer_run(void* data)
+{
+    TileRenderer* renderer = (TileRenderer*) data;
+    int generation = 0;
+
+    pthread_mutex_lock(&renderer->lock);
+    while (!renderer->isClosing)
+    {
+        if (renderer->generation != generation)
+        {
+            generation = renderer->generation;
+            pthread_mutex_unlock(&renderer->lock);
+            drawTiles(renderer);
+            pthread_mutex_lock(&renderer->lock);
+            renderer->numBusy--;
+            if (renderer->numBusy == 0)
+            {
+                pthread_cond_signal(&renderer->finished);
+            }
+        }
+        else
+        {
+            pthread_cond_wait(&renderer->started, &renderer->lock);
+        }
+    }
+    pthread_mutex_unlock(&renderer->lock);
+
+    return NULL;
+}
+
+/**
+ * A private function that sorts the lines into the tiles their rows pass
+ * through, keeping the order they were added in. The tiles are counted from
+ * the band holding the top row of any line.
+ *
+ * Returns:
+ *  true(non-zero) if the tiles are ready to draw, false(zero) if the lines
+ *  cover too few cells to be worth it, reach over more than MAX_TILES bands,
+ *  or memory ran out
+ */
+static int binSegments(TileRenderer* renderer, Canvas* canvas)
+{
+    int counts[MAX_TILES];
+    int ii, jj, top, bottom, count, numBinned, firstBand;
+    int minRow = 0, maxRow = 0;
+    long numCells = 0;
+    int* binned;
+    Segment* segment;
+    Tile* tile;
+    int isReady;
+
+    /* Find the rows the batch reaches over */
+    for (ii = 0; ii < renderer->numSegments; ii++)
+    {
+        segment = &(renderer->segments[ii]);
+        if (getRows(canvas, segment, &top, &bottom, &count))
+        {
+            if (numCells == 0 || top < minRow)
+            {
+                minRow = top;
+            }
+            if (numCells == 0 || bottom > maxRow)
+            {
+                maxRow = bottom;
+            }
+            numCells += count;
+        }
+    }
+    firstBand = floorDivide(minRow, TILE_HEIGHT);
+    isReady = numCells >= MIN_PARALLEL_CELLS &&
+              floorDivide(maxRow, TILE_HEIGHT) - firstBand < MAX_TILES;
+
+    /* Count the lines in each tile */
+    numBinned = 0;
+    for (ii = 0; ii < MAX_TILES; ii++)
+    {
+        counts[ii] = 0;
+    }
+    for (ii = 0; ii < renderer->numSegments && isReady; ii++)
+    {
+        if (getRows(canvas, &(renderer->segments[ii]), &top, &bottom, &count))
+        {
+            for (jj = floorDivide(top, TILE_HEIGHT) - firstBand;
+                 jj <= floorDivide(bottom, TILE_HEIGHT) - firstBand; jj++)
+            {
+                counts[jj]++;
+                numBinned++;
+            }
+        }
+    }
+
+    if (isReady && numBinned > renderer->binCapacity)
+    {
+        binned = (int*) realloc(renderer->binned, numBinned * sizeof(int));
+        isReady = binned != NULL;
+        if (isReady)
+        {
+            renderer->binned = binned;
+            renderer->binCapacity = numBinned;
+        }
+    }
+
+    if (isReady)
+    {
+        /* Make a tile of each band of rows with lines in it, then fill in its
+         * lines in order */
+        renderer->numTiles = 0;
+        numBinned = 0;
+        for (ii = 0; ii < MAX_TILES; ii++)
+        {
+            if (counts[ii] > 0)
+            {
+                tile = &(renderer->tiles[renderer->numTiles]);
+                tile->top = (firstBand + ii) * TILE_HEIGHT;
+                tile->bottom = tile->top + (TILE_HEIGHT - 1);
+                if (tile->top < canvas->top)
+                {
+                    tile->top = canvas->top;
+                }
+                if (tile->bottom > canvas->bottom)
+                {
+                    tile->bottom = canvas->bottom;
+                }
+                tile->first = numBinned;
+                tile->last = numBinned;
+                tile->numCells = 0;
+                tile->canvasTile = NULL;
+                numBinned += counts[ii];
+                counts[ii] = renderer->numTiles;
+                renderer->numTiles++;
+            }
+        }
+        for (ii = 0; ii < renderer->numSegments; ii++)
+        {
+            if (getRows(canvas, &(renderer->segments[ii]), &top, &bottom, &count))
+            {
+                for (jj = floorDivide(top, TILE_HEIGHT) - firstBand;
+                     jj <= floorDivide(bottom, TILE_HEIGHT) - firstBand; jj++)
+                {
+                    tile = &(renderer->tiles[counts[jj]]);
+                    renderer->binned[tile->last] = ii;
+                    tile->last++;
+                }
+            }
+        }
+    }
+
+    return isReady;
+}
+
+/**
+ * A private function that finds the rows of the canvas's viewport a line
+ * passes through, once it is clipped to the viewport.
+ *
+ * Parameters:
+ *  canvas   - the Canvas the line is drawn on
+ *  segment  - the line
+ *  top      - (export) the first row
+ *  bottom   - (export) the last row
+ *  numCells - (export) the number of cells inside the viewport
+ * Returns:
+ *  true(non-zero) if any of the line is in the viewport, false(zero) if it is
+ *  entirely outside it
+ */
+static int getRows(Canvas* canvas, Segment* segment, int* top, int* bottom,
+                   int* numCells)
+{
+    ClippedLine clip;
+    int isInside;
+
+    isInside = Canvas_clipLine(segment->x1, segment->y1, segment->x2, segment->y2,
+                               canvas->left, canvas->top, canvas->right,
+                               canvas->bottom, &clip);
+    if (isInside)
+    {
+        *top = clip.y < clip.endY ? clip.y : clip.endY;
+        *bottom = clip.y < clip.endY ? clip.endY : clip.y;
+        *numCells = clip.last - clip.first + 1;
+    }
+
+    return isInside;
+}
+
+/**
+ * A private function that takes tiles and draws their lines until every tile
+ * of the batch has been taken.
+ */
+static void drawTiles(TileRenderer* renderer)
+{
+    int ii, next;
+    Tile* tile;
+
+    do
+    {
+        pthread_mutex_lock(&renderer->lock);
+        next = renderer->nextTile;
+        if (next < renderer->numTiles)
+        {
+            renderer->nextTile++;
+        }
+        pthread_mutex_unlock(&renderer->lock);
+
+        if (next < renderer->numTiles)
+        {
+            tile = &(renderer->tiles[next]);
+            for (ii = tile->first; ii < tile->last; ii++)
+            {
+                drawSegment(renderer, tile,
+                            &(renderer->segments[renderer->binned[ii]]));
+            }
+        }
+    }
+    while (next < renderer->numTiles);
+}
+
+/**
+ * A private function that draws the part of a line inside a tile, covering the
+ * same cells as Canvas_drawLine() does there. The line is clipped to the tile's
+ * rows and the viewport's columns, and stepped over from the first step inside
+ * by Canvas_stepLine().
+ */
+static void drawSegment(TileRenderer* renderer, Tile* tile, Segment* segment)
+{
+    ClippedLine clip;
+    TilePen tilePen;
+
+    if (!Canvas_clipLine(segment->x1, segment->y1, segment->x2, segment->y2,
+                         renderer->canvas->left, tile->top, renderer->canvas->right,
+                         tile->bottom, &clip))
+    {
+        /* Nothing inside the tile */
+    }
+    else if (clip.dy == 0)
+    {
+        plotSpan(renderer, tile, clip.y, clip.x < clip.endX ? clip.x : clip.endX,
+                 clip.x < clip.endX ? clip.endX : clip.x, &(segment->pen));
+    }
+    else
+    {
+        tilePen.renderer = renderer;
+        tilePen.tile = tile;
+        tilePen.pen = &(segment->pen);
+        Canvas_stepLine(&clip, &plotCell, &tilePen);
+    }
+}
+
+/**
+ * A private function that plots a single cell of a tile with the pen of a
+ * TilePen, ignoring cells off the left or right of the viewport. Matches the
+ * CellPlotFunc required by Canvas_stepLine().
+ */
+static void plotCell(int x, int y, void* tilePen)
+{
+    TileRenderer* renderer = ((TilePen*) tilePen)->renderer;
+    Tile* tile = ((TilePen*) tilePen)->tile;
+    Cell* pen = ((TilePen*) tilePen)->pen;
+    CanvasTile* canvasTile;
+    int column, row;
+
+    if (x >= renderer->canvas->left && x <= renderer->canvas->right)
+    {
+        canvasTile = getCanvasTile(renderer, tile, x, y);
+        if (canvasTile != NULL)
+        {
+            column = x - canvasTile->left;
+            row = y - canvasTile->top;
+            canvasTile->cells[row * CANVAS_TILE_SIZE + column] = *pen;
+            tile->numCells++;
+            if (column < canvasTile->dirtyLeft[row])
+            {
+                canvasTile->dirtyLeft[row] = (signed char) column;
+            }
+            if (column > canvasTile->dirtyRight[row])
+            {
+                canvasTile->dirtyRight[row] = (signed char) column;
+            }
+            if (row < canvasTile->dirtyTop)
+            {
+                canvasTile->dirtyTop = row;
+            }
+            if (row > canvasTile->dirtyBottom)
+            {
+                canvasTile->dirtyBottom = row;
+            }
+        }
+    }
+}
+
+/**
+ * A private function that plots every cell of a row of a tile from the left
+ * column to the right column with a pen, a canvas tile at a time.
+ */
+static void plotSpan(TileRenderer* renderer, Tile* tile, int y, int left,
+                     int right, Cell* pen)
+{
+    CanvasTile* canvasTile;
+    int x, tileRight, row;
+    int isDone;
+
+    if (left < renderer->canvas->left)
+    {
+        left = renderer->canvas->left;
+    }
+    if (right > renderer->canvas->right)
+    {
+        right = renderer->canvas->right;
+    }
+
+    isDone = left > right;
+    while (!isDone)
+    {
+        tileRight = floorDivide(left, CANVAS_TILE_SIZE) * CANVAS_TILE_SIZE +
+                    (CANVAS_TILE_SIZE - 1);
+        if (tileRight > right)
+        {
+            tileRight = right;
+        }
+
+        canvasTile = getCanvasTile(renderer, tile, left, y);
+        if (canvasTile != NULL)
+        {
+            row = y - canvasTile->top;
+            for (x = left; x <= tileRight; x++)
+            {
+                canvasTile->cells[row * CANVAS_TILE_SIZE + x - canvasTile->left] = *pen;
+            }
+            tile->numCells += tileRight - left + 1;
+            if (left - canvasTile->left < canvasTile->dirtyLeft[row])
+            {
+                canvasTile->dirtyLeft[row] = (signed char) (left - canvasTile->left);
+            }
+            if (tileRight - canvasTile->left > canvasTile->dirtyRight[row])
+            {
+                canvasTile->dirtyRight[row] = (signed char) (tileRight - canvasTile->left);
+            }
+            if (row < canvasTile->dirtyTop)
+            {
+                canvasTile->dirtyTop = row;
+            }
+            if (row > canvasTile->dirtyBottom)
+            {
+                canvasTile->dirtyBottom = row;
+            }
+        }
+
+        isDone = tileRight == right;
+        left = tileRight + 1;
+    }
+}
+
+/**
+ * A private function that finds the canvas tile holding a cell of a tile. The
+ * canvas tile plotted last is used again while the cell is in it, otherwise
+ * the canvas is searched under the lock, which allocates the canvas tile if
+ * it is new.
+ *
+ * Returns:
+ *  the canvas tile, or NULL if memory ran out
+ */
+static CanvasTile* getCanvasTile(TileRenderer* renderer, Tile* tile, int x, int y)
+{
+    CanvasTile* canvasTile = tile->canvasTile;
+
+    if (canvasTile == NULL ||
+        (unsigned int) x - (unsigned int) canvasTile->left >= CANVAS_TILE_SIZE ||
+        (unsigned int) y - (unsigned int) canvasTile->top >= CANVAS_TILE_SIZE)
+    {
+        pthread_mutex_lock(&renderer->growLock);
+        canvasTile = Canvas_touchTile(renderer->canvas, x, y);
+        pthread_mutex_unlock(&renderer->growLock);
+        tile->canvasTile = canvasTile;
+    }
+
+    return canvasTile;
+}
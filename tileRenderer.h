@@ -0,0 +1,30 @@
+#ifndef TILERENDERER_H
+#define TILERENDERER_H
+
+#include "canvas.h"
+
+/**
+ * A struct representing a line waiting to be drawn from the cell (x1, y1) to
+ * the cell (x2, y2), along with the pen it is drawn with.
+ */
+typedef struct
+{
+    int x1;
+    int y1;
+    int x2;
+    int y2;
+    Cell pen;
+} Segment;
+
+typedef struct TileRenderer TileRenderer;
+
+TileRenderer* TileRenderer_create(int numThreads);
+
+void TileRenderer_add(TileRenderer* renderer, Canvas* canvas, int x1, int y1,
+                      int x2, int y2);
+
+void TileRenderer_flush(TileRenderer* renderer, Canvas* canvas);
+
+void TileRenderer_free(TileRenderer* renderer);
+
+#endif
@@ -1,129 +1,890 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include "turtleGraphics.h"
+#include "batch.h"
+#include "server.h"
 
-/* Number of expected command line arguments */
-#define NUM_ARGS 2
+/* Option which executes commands as they are read */
+#define STREAM_OPTION "--stream"
+
+/* Option which writes the log in binary to BINARY_LOG_NAME */
+#define BINARY_LOG_OPTION "--binary-log"
+
+/* Option which prints a binary log file as text instead of drawing */
+#define DECODE_LOG_OPTION "--decode-log"
+
+/* Option, followed by a file name, which draws into an image file instead of
+ * the terminal */
+#define OUTPUT_OPTION "--output"
+
+/* Option, followed by a number of pixels, which sets the size of each cell in
+ * the image */
+#define SCALE_OPTION "--scale"
+
+/* Options which print statistics of the run to stderr as a table or as JSON */
+#define STATS_OPTION "--stats"
+#define STATS_JSON_OPTION "--stats-json"
+
+/* Option, followed by a number of threads, which sets how many threads draw
+ * the lines */
+#define THREADS_OPTION "--threads"
+
+/* Options which optimise the Program before executing it, keeping graphics.log
+ * exactly the same, or also joining MOVEs so the log has fewer records */
+#define OPTIMISE_OPTION "-O"
+#define OPTIMISE_RELAXED_OPTION "-O2"
+
+/* Option, followed by a file name, which compiles the input file into a
+ * program file instead of drawing */
+#define COMPILE_OPTION "--compile"
+
+/* Option which keeps a compiled copy of the input file beside it and reads
+ * that instead while the file is unchanged */
+#define CACHE_OPTION "--cache"
+
+/* Option which lets the turtle go above and left of the top left of the
+ * terminal instead of stopping */
+#define UNBOUNDED_OPTION "--unbounded"
+
+/* Option, followed by <left>,<top>,<width>,<height> in cells, which chooses the
+ * part of the drawing shown in the terminal or written to the image */
+#define VIEWPORT_OPTION "--viewport"
+
+/* Option, followed by a suffix, which draws every input file into a file of
+ * its own named with the suffix added, as an image when the suffix is .ppm,
+ * .pgm or .pbm */
+#define BATCH_OPTION "--batch"
+
+/* Option, followed by a file name ("-" for stdin), which adds the input files
+ * listed in it, one on each line, to those drawn by --batch */
+#define MANIFEST_OPTION "--manifest"
+
+/* Option, followed by the path of a Unix domain socket, which draws the
+ * commands sent to it until interrupted instead of drawing a file */
+#define SERVE_OPTION "--serve"
+
+/* Number of pixels along each side of a cell in the image by default */
+#define DEFAULT_SCALE 8
+
+/* Number of commands read and executed at a time when streaming */
+#define STREAM_BATCH_SIZE 256
+
+static int parseArguments(int argc, char* argv[], Options* options,
+                          char** fileNames, int* numFiles);
+
+static int parseViewport(char* text, Options* options);
+
+static int writeImage(Canvas* canvas, Options* options, Sink* sink);
+
+static void printInvalidInput(FILE* errors);
+
+static void printUsage();
 
 /**
  * Parameters:
- *  argc - two
- *  argv - executableName, input fileName
+ *  argc - the number of arguments, including options
+ *  argv - executableName, [--stream | -O | -O2] [--cache] [--compile
+ *         programFileName] [--binary-log] [--output imageFileName [--scale
+ *         pixels]] [--unbounded] [--viewport left,top,width,height] [--stats |
+ *         --stats-json] [--threads number], input fileName ("-" for stdin, or
+ *         a compiled program file), or executableName, --batch suffix,
+ *         [--manifest listFileName], [other options], input fileNames, or
+ *         executableName, --serve socketName, [other options], or
+ *         executableName, --decode-log, binary log fileName
  * Returns:
- *  An error code for a corresponding error, please see fileIO.c:15 for details
+ *  An error code for a corresponding error, please see readCommandsFromFile()
+ *  in fileIO.c for details
  */
 int main(int argc, char* argv[])
 {
     int errNo;
+    char** fileNames;
     char* fileName;
-    LinkedList* cmdList;
-    int isFileValid;
+    int numFiles;
+    Options options;
+    Program* program;
+    Sink sink;
+    double start, readStart;
+    int numCommands;
 
     errNo = 0;
-
-    if (argc == NUM_ARGS)
+    start = Stats_getTime();
+    #ifdef STATS
+    stats.hasCounters = TRUE;
+    #endif
+    /* A single run draws to the terminal and adds to the log file */
+    sink.output = stdout;
+    sink.format = IMAGE_NONE;
+    sink.logFile = NULL;
+    sink.errors = stderr;
+    sink.stats = &stats;
+    sink.canvas = NULL;
+    fileNames = NULL;
+    fileNames = (char**) malloc(argc * sizeof(char*));
+    if (fileNames == NULL)
+    {
+        errNo = 3; /* System error */
+        fprintf(stderr, "ERROR: Could not allocate memory for the file names.\n");
+    }
+    else if (parseArguments(argc, argv, &options, fileNames, &numFiles))
     {
-        fileName = argv[1];
-        /* Returns zero on success, program will exit if a line is invalid */
-        isFileValid = validateInputFile(fileName);
-        if (isFileValid == 0)
+        program = NULL;
+        fileName = fileNames[0];
+        if (options.batchSuffix != NULL)
+        {
+            errNo = renderBatch(fileNames, numFiles, &options);
+        }
+        else if (options.socketName != NULL)
+        {
+            errNo = serveRequests(options.socketName, &options);
+        }
+        else if (options.isDecodeLog)
+        {
+            errNo = decodeLog(fileName, stdout);
+        }
+        else if (options.isStream)
+        {
+            errNo = streamCommandsFromFile(fileName, &options, &sink);
+        }
+        else
         {
-            cmdList = NULL;
-            /* Read all commands from the file into a Linked List */
-            cmdList = readCommandsFromFile(fileName);
-            if (cmdList != NULL)
+            /* Validate and read all commands from the file into a Program in
+             * a single pass. Returns zero on success */
+            readStart = Stats_getTime();
+            errNo = loadProgram(fileName, &program, &options, stderr);
+            if (errNo == 0 && options.optimiseLevel != OPTIMISE_OFF)
             {
-                /* Sets the colours for TurtleGraphicsSimple */
-                #ifdef NO_COLOURS
-                setColoursSimple();
-                #endif
-                clearScreen();
-                executeCommands(cmdList);
-                resetColours();
-                penDown();
-                /* Free a generic Linked List with a function pointer to free
-                 * the data inside a node */
-                LinkedList_free(cmdList, &freeCommand);
+                numCommands = program->size;
+                stats.commandsRemoved = optimiseProgram(program,
+                                                        options.optimiseLevel);
+                fprintf(stderr, "Optimised away %ld of %d commands.\n",
+                        stats.commandsRemoved, numCommands);
+            }
+            stats.times[PHASE_READ] = Stats_getTime() - readStart;
+            if (errNo == 0 && options.compileName != NULL)
+            {
+                errNo = writeProgramFile(program, options.compileName, fileName);
+                Program_free(program);
+            }
+            else if (errNo == 0)
+            {
+                errNo = executeCommands(program, NULL, &options, &sink);
+                Program_free(program);
             }
             else
             {
-                fprintf(stderr, "ERROR: Could not create the linked list.\n");
+                printInvalidInput(stderr);
             }
         }
+
+        if (options.statsFormat != STATS_OFF)
+        {
+            stats.times[PHASE_TOTAL] = Stats_getTime() - start;
+            Stats_print(stderr, options.statsFormat);
+        }
+    }
+    else
+    {
+        printUsage();
+    }
+    free(fileNames);
+    fileNames = NULL;
+
+    return errNo;
+}
+
+/**
+ * Reads and executes the commands of a file in batches of STREAM_BATCH_SIZE, so
+ * memory use does not depend on the length of the file and the drawing appears
+ * while the file is still being read. Unlike readCommandsFromFile, commands
+ * before an invalid line are executed.
+ *
+ * Parameters:
+ *  fileName - the name of the file to read the commands from, or "-" for stdin
+ *  options  - the options given on the command line
+ *  sink     - where the drawing, the log, the errors and the statistics are
+ *             written
+ * Returns:
+ *  the same error codes as readCommandsFromFile
+ */
+int streamCommandsFromFile(char* fileName, Options* options, Sink* sink)
+{
+    int errNo;
+    LineReader* reader;
+    Program* program;
+
+    errNo = 0;
+    reader = NULL;
+    reader = LineReader_open(fileName);
+    if (reader != NULL)
+    {
+        program = NULL;
+        program = Program_create();
+        if (program != NULL)
+        {
+            errNo = executeCommands(program, reader, options, sink);
+            Program_free(program);
+        }
         else
         {
-            errNo = isFileValid;
-            fprintf(stderr, "ERROR: The input file is invalid. ");
-            fprintf(stderr, "Please re-run the program with a valid input file.\n");
+            errNo = 3; /* System error */
+            fprintf(sink->errors, "ERROR: Could not allocate memory for the "
+                    "commands.\n");
+            printInvalidInput(sink->errors);
+        }
+
+        if (LineReader_close(reader) != 0)
+        {
+            errNo = 2; /* Error closing file */
+            printSystemError(sink->errors, "ERROR: The file was not closed "
+                             "successfully");
+            printInvalidInput(sink->errors);
         }
     }
     else
     {
-        fprintf(stderr, "ERROR: Invalid number of arguments. ");
-        fprintf(stderr, "Usage: ./TurtleGraphics <fileName>\n");
+        errNo = 1; /* File could not be opened */
+        printSystemError(sink->errors, "ERROR: The file could not be opened");
+        printInvalidInput(sink->errors);
     }
 
     return errNo;
 }
 
 /**
- * Iterates through each command in the Linked List and executes them. Printing
- * to the log file occurs at every DRAW and MOVE command.
+ * Prepares the terminal for drawing by clearing it.
  *
  * Parameters:
- *  cmdList - the Linked List of commands to execute
+ *  terminal - the Terminal to draw in
  */
-void executeCommands(LinkedList* cmdList)
+void startDrawing(Terminal* terminal)
 {
-    Command* command;
+    /* Sets the colours for TurtleGraphicsSimple */
+    #ifdef NO_COLOURS
+    setColoursSimple(terminal);
+    #endif
+    Terminal_clear(terminal);
+}
+
+/**
+ * Restores the terminal's colours, moves the cursor below the drawing and
+ * writes everything left in the Terminal.
+ *
+ * Parameters:
+ *  terminal - the Terminal drawn in
+ */
+void finishDrawing(Terminal* terminal)
+{
+    resetColours(terminal);
+    Terminal_moveBelow(terminal);
+    Terminal_flush(terminal);
+}
+
+/**
+ * Iterates through each command in the Program and executes them. Every DRAW
+ * and MOVE command is recorded in the log, which is written in the background.
+ * Lines are drawn on an off-screen canvas which is written to the terminal once
+ * all the commands have been executed, or once the cursor goes out of bounds.
+ * With an output file, or a sink with an image format, the terminal is left
+ * alone and the canvas is written to the image once at the end instead. With
+ * --unbounded the cursor may go above and left of the terminal, and only the
+ * viewport is shown. Nothing is written to stdout, the log file or the
+ * statistics directly, only to the sink, so several drawings can run at once.
+ *
+ * When a LineReader is given, the Program is used as a bounded buffer instead:
+ * it is refilled from the reader with up to STREAM_BATCH_SIZE commands at a
+ * time, and the canvas is written after each batch.
+ *
+ * Parameters:
+ *  program - the Program of commands to execute
+ *  stream  - the LineReader to refill the Program from, or NULL
+ *  options - the options given on the command line
+ *  sink    - where the drawing, the log, the errors and the statistics are
+ *            written
+ * Returns:
+ *  0, or the error code of the first invalid line read from the stream or of
+ *  writing the image, or 12 if the drawing would execute more commands than
+ *  options allow, please see readCommandsFromFile() in fileIO.c for details
+ */
+int executeCommands(Program* program, LineReader* stream, Options* options,
+                    Sink* sink)
+{
+    int errNo, repeatErrNo;
+    int numValid;
+    int isEmpty;
+    int isTerminal;
+    double start;
     TurtleSettings* settings;
-    FILE* logFile;
+    Canvas* canvas;
+    LogWriter* log;
+    Geometry* geometry;
+    TileRenderer* renderer;
+    Terminal* terminal;
+    ProgramCounter counter;
+    Stats* runStats;
     int isInBounds;
 
+    errNo = 0;
+    runStats = sink->stats;
+    isTerminal = options->outputName == NULL && sink->format == IMAGE_NONE;
+    terminal = NULL;
+    if (isTerminal)
+    {
+        terminal = Terminal_create(sink->output);
+        if (terminal != NULL)
+        {
+            startDrawing(terminal);
+        }
+    }
+
     settings = NULL;
     /* Create a settings struct to keep track of the graphics parameters */
     settings = createSettings();
-    logFile = NULL;
-    logFile = fopen("graphics.log", "a");
-    if (logFile != NULL && settings != NULL)
+    canvas = NULL;
+    if (sink->canvas != NULL)
+    {
+        canvas = sink->canvas;
+        Canvas_reset(canvas);
+    }
+    else
+    {
+        canvas = Canvas_create();
+    }
+    log = NULL;
+    if (sink->logFile != NULL)
+    {
+        log = LogWriter_openStream(sink->logFile, options->isBinaryLog);
+    }
+    else
+    {
+        log = LogWriter_open(options->isBinaryLog);
+    }
+    geometry = Geometry_create();
+    renderer = TileRenderer_create(options->numThreads);
+    /* Counts each command executed, including every repetition */
+    counter.numExecuted = NULL;
+    if (options->statsFormat != STATS_OFF)
     {
-        fprintf(logFile, "---\n");
+        counter.numExecuted = runStats->commands;
+    }
+    counter.numLeft = options->maxExecuted > 0 ? options->maxExecuted : -1;
+    if (log != NULL && settings != NULL && canvas != NULL && geometry != NULL &&
+        renderer != NULL && (terminal != NULL || !isTerminal))
+    {
+        Canvas_setPattern(canvas, settings->pattern);
+        settings->isBounded = !options->isUnbounded;
+        if (options->viewportWidth > 0)
+        {
+            Canvas_setViewport(canvas, options->viewportLeft, options->viewportTop,
+                               options->viewportLeft + options->viewportWidth - 1,
+                               options->viewportTop + options->viewportHeight - 1);
+        }
+        else if (options->isUnbounded && !isTerminal)
+        {
+            /* Keep everything, the image is cut to what was drawn */
+            Canvas_setViewport(canvas, INT_MIN, INT_MIN, INT_MAX, INT_MAX);
+        }
         /* The program should exit when the x or y coordinate goes out of the
          * terminal bounds */
         isInBounds = TRUE;
-        while (!LinkedList_isEmpty(cmdList) && isInBounds)
+        isEmpty = TRUE;
+        do
         {
-            /* Check the current cursor coordinate is valid */
-            if (roundNum(settings->pos.x) >= 0 && roundNum(settings->pos.y) >= 0)
+            if (stream != NULL)
             {
-                /* Much quicker to remove the first Command instead of using get */
-                command = (Command*) LinkedList_removeFirst(cmdList);
-                executeCommand(settings, command, logFile);
-                /* removeFirst returns a malloc'ed Command*, so free it */
-                freeCommand(command);
+                start = Stats_getTime();
+                program->size = 0;
+                errNo = readCommands(stream, program, STREAM_BATCH_SIZE, &isEmpty,
+                                     sink->errors);
+                /* Only the commands before an unmatched REPEAT or END are
+                 * executed, and only reported when the lines were valid */
+                repeatErrNo = checkRepeats(program, &numValid,
+                                           errNo == 0 ? sink->errors : NULL);
+                if (errNo == 0)
+                {
+                    errNo = repeatErrNo;
+                }
+                program->size = numValid;
+                runStats->times[PHASE_READ] += Stats_getTime() - start;
             }
-            else
+            if (program->size > runStats->peakCommands)
+            {
+                runStats->peakCommands = program->size;
+            }
+
+            start = Stats_getTime();
+            ProgramCounter_reset(&counter);
+            isInBounds = executeProgram(settings, canvas, program, &counter,
+                                        geometry, renderer, log);
+            runStats->times[PHASE_EXECUTE] += Stats_getTime() - start;
+            if (counter.next < program->size && isInBounds && errNo == 0)
+            {
+                errNo = 12; /* Too many commands executed */
+                fprintf(sink->errors, "ERROR: The drawing executes more than %ld "
+                        "commands.\n", options->maxExecuted);
+            }
+
+            if (isTerminal)
+            {
+                /* Write everything drawn so far to the terminal in one pass */
+                start = Stats_getTime();
+                runStats->escapeBytes += Canvas_emit(canvas, terminal);
+                Terminal_flush(terminal);
+                runStats->times[PHASE_OUTPUT] += Stats_getTime() - start;
+            }
+        }
+        while (stream != NULL && errNo == 0 && isInBounds &&
+               !LineReader_isAtEnd(stream));
+
+        if (!isInBounds)
+        {
+            if (isTerminal)
             {
-                isInBounds = FALSE;
-                penDown();
+                Terminal_moveBelow(terminal);
                 /* Flush output so the cursor moves down before printing error */
-                fflush(stdout);
-                fprintf(stderr, "ERROR: Invalid drawing. Cursor position is not valid.\n");
+                Terminal_flush(terminal);
             }
+            fprintf(sink->errors, "ERROR: Invalid drawing. Cursor position is not "
+                    "valid.\n");
+        }
+        else if (stream != NULL && isEmpty && errNo == 0)
+        {
+            errNo = 4; /* Input file is empty */
+            fprintf(sink->errors, "ERROR: The input file is empty.\n");
         }
 
-        /* Check if the file closed successfully */
-        if (fclose(logFile) != 0)
+        if (errNo != 0)
         {
-            perror("ERROR: The file was not closed successfully");
+            printInvalidInput(sink->errors);
         }
+        else if (!isTerminal)
+        {
+            /* The image shows everything drawn, even when the drawing went out
+             * of bounds */
+            start = Stats_getTime();
+            errNo = writeImage(canvas, options, sink);
+            runStats->times[PHASE_OUTPUT] = Stats_getTime() - start;
+        }
+
+        runStats->allocations = canvas->arena->numAllocations;
+        runStats->arenaBlocks = canvas->arena->numBlocks;
+
+        /* Check if every record was written and the file closed successfully */
+        if (LogWriter_close(log) != 0)
+        {
+            printSystemError(sink->errors, "ERROR: The file was not closed "
+                             "successfully");
+        }
+    }
+    else if (log == NULL)
+    {
+        printSystemError(sink->errors, "ERROR: The log file could not be opened");
     }
     else
     {
-        perror("ERROR: The log file could not be opened");
+        fprintf(sink->errors, "ERROR: Could not allocate memory for the drawing.\n");
+        LogWriter_close(log);
     }
 
     /*Free allocated memory */
     free(settings);
     settings = NULL;
+    if (canvas != sink->canvas)
+    {
+        Canvas_free(canvas);
+    }
+    canvas = NULL;
+    free(geometry);
+    geometry = NULL;
+    TileRenderer_free(renderer);
+    renderer = NULL;
+    if (terminal != NULL)
+    {
+        finishDrawing(terminal);
+    }
+    Terminal_free(terminal);
+    terminal = NULL;
+
+    return errNo;
+}
+
+/**
+ * A private function that reads the options and the file names from the
+ * command line arguments. Options may come in any order, but --decode-log
+ * cannot be used with any other option, --scale needs --output, --batch or
+ * --serve, -O, --compile and --cache cannot be used with --stream as they need
+ * the whole Program, --compile draws nothing so cannot be used with --output,
+ * and -O cannot be used with --unbounded as it cuts the Program where a
+ * bounded drawing stops. Only --batch takes more than one file name, or none
+ * with --manifest, and it names each output itself, so cannot be used with
+ * --output, --compile, --stream or --decode-log. --serve takes no file name,
+ * as the commands are sent to it, and cannot be used with those or with
+ * --batch, --manifest or --cache.
+ *
+ * Parameters:
+ *  argc      - the number of command line arguments
+ *  argv      - the command line arguments
+ *  options   - (export) the options given
+ *  fileNames - (export) the input file names, room for argc of them
+ *  numFiles  - (export) the number of input file names
+ * Returns:
+ *  true(non-zero) if the arguments are valid, false(zero) otherwise
+ */
+static int parseArguments(int argc, char* argv[], Options* options,
+                          char** fileNames, int* numFiles)
+{
+    int ii;
+    int numOptions;
+    int isValid = TRUE;
+    int isScaleGiven = FALSE;
+
+    options->isStream = FALSE;
+    options->isBinaryLog = FALSE;
+    options->isDecodeLog = FALSE;
+    options->outputName = NULL;
+    options->scale = DEFAULT_SCALE;
+    options->statsFormat = STATS_OFF;
+    options->numThreads = 0;
+    options->optimiseLevel = OPTIMISE_OFF;
+    options->compileName = NULL;
+    options->isCached = FALSE;
+    options->isUnbounded = FALSE;
+    options->viewportWidth = 0;
+    options->batchSuffix = NULL;
+    options->manifestName = NULL;
+    options->socketName = NULL;
+    options->maxExecuted = 0;
+    *numFiles = 0;
+    numOptions = 0;
+
+    for (ii = 1; ii < argc && isValid; ii++)
+    {
+        if (strcmp(argv[ii], STREAM_OPTION) == 0)
+        {
+            options->isStream = TRUE;
+            numOptions++;
+        }
+        else if (strcmp(argv[ii], BINARY_LOG_OPTION) == 0)
+        {
+            options->isBinaryLog = TRUE;
+            numOptions++;
+        }
+        else if (strcmp(argv[ii], DECODE_LOG_OPTION) == 0)
+        {
+            options->isDecodeLog = TRUE;
+            numOptions++;
+        }
+        else if (strcmp(argv[ii], OPTIMISE_OPTION) == 0)
+        {
+            options->optimiseLevel = OPTIMISE_EXACT;
+            numOptions++;
+        }
+        else if (strcmp(argv[ii], OPTIMISE_RELAXED_OPTION) == 0)
+        {
+            options->optimiseLevel = OPTIMISE_RELAXED;
+            numOptions++;
+        }
+        else if (strcmp(argv[ii], CACHE_OPTION) == 0)
+        {
+            options->isCached = TRUE;
+            numOptions++;
+        }
+        else if (strcmp(argv[ii], COMPILE_OPTION) == 0 && ii + 1 < argc)
+        {
+            ii++;
+            options->compileName = argv[ii];
+            numOptions++;
+        }
+        else if (strcmp(argv[ii], UNBOUNDED_OPTION) == 0)
+        {
+            options->isUnbounded = TRUE;
+            numOptions++;
+        }
+        else if (strcmp(argv[ii], VIEWPORT_OPTION) == 0 && ii + 1 < argc)
+        {
+            ii++;
+            isValid = parseViewport(argv[ii], options);
+            numOptions++;
+        }
+        else if (strcmp(argv[ii], STATS_OPTION) == 0)
+        {
+            options->statsFormat = STATS_TEXT;
+            numOptions++;
+        }
+        else if (strcmp(argv[ii], STATS_JSON_OPTION) == 0)
+        {
+            options->statsFormat = STATS_JSON;
+            numOptions++;
+        }
+        else if (strcmp(argv[ii], OUTPUT_OPTION) == 0 && ii + 1 < argc)
+        {
+            ii++;
+            options->outputName = argv[ii];
+            numOptions++;
+        }
+        else if (strcmp(argv[ii], SCALE_OPTION) == 0 && ii + 1 < argc)
+        {
+            ii++;
+            isValid = isInteger(argv[ii], (int) strlen(argv[ii]), &(options->scale)) &&
+                      options->scale >= 1 && options->scale <= MAX_IMAGE_SCALE;
+            isScaleGiven = TRUE;
+            numOptions++;
+        }
+        else if (strcmp(argv[ii], THREADS_OPTION) == 0 && ii + 1 < argc)
+        {
+            ii++;
+            isValid = isInteger(argv[ii], (int) strlen(argv[ii]), &(options->numThreads)) &&
+                      options->numThreads >= 1 && options->numThreads <= MAX_THREADS;
+            numOptions++;
+        }
+        else if (strcmp(argv[ii], BATCH_OPTION) == 0 && ii + 1 < argc)
+        {
+            ii++;
+            options->batchSuffix = argv[ii];
+            numOptions++;
+        }
+        else if (strcmp(argv[ii], MANIFEST_OPTION) == 0 && ii + 1 < argc)
+        {
+            ii++;
+            options->manifestName = argv[ii];
+            numOptions++;
+        }
+        else if (strcmp(argv[ii], SERVE_OPTION) == 0 && ii + 1 < argc)
+        {
+            ii++;
+            options->socketName = argv[ii];
+            numOptions++;
+        }
+        else
+        {
+            fileNames[*numFiles] = argv[ii];
+            (*numFiles)++;
+        }
+    }
+
+    if (options->socketName != NULL)
+    {
+        isValid = isValid && *numFiles == 0 && options->batchSuffix == NULL &&
+                  options->manifestName == NULL && !options->isStream &&
+                  !options->isDecodeLog && options->outputName == NULL &&
+                  options->compileName == NULL && !options->isCached;
+    }
+    else if (options->batchSuffix == NULL)
+    {
+        isValid = isValid && *numFiles == 1 && options->manifestName == NULL;
+    }
+    else
+    {
+        isValid = isValid && (*numFiles > 0 || options->manifestName != NULL) &&
+                  !options->isStream && !options->isDecodeLog &&
+                  options->outputName == NULL && options->compileName == NULL;
+    }
+
+    return isValid &&
+           (!options->isDecodeLog || numOptions == 1) &&
+           (!isScaleGiven || options->outputName != NULL ||
+            options->batchSuffix != NULL || options->socketName != NULL) &&
+           (!options->isStream || (options->optimiseLevel == OPTIMISE_OFF &&
+                                   options->compileName == NULL &&
+                                   !options->isCached)) &&
+           (options->compileName == NULL || options->outputName == NULL) &&
+           (!options->isUnbounded || options->optimiseLevel == OPTIMISE_OFF);
+}
+
+/**
+ * A private function that reads a viewport written as
+ * <left>,<top>,<width>,<height>, in cells from the top left of the terminal.
+ * The corner must be within MAX_COORDINATE of it, and the viewport at most
+ * MAX_CANVAS_SIZE cells along each side.
+ *
+ * Parameters:
+ *  text    - the viewport as written on the command line
+ *  options - (export) the options to hold the viewport
+ * Returns:
+ *  true(non-zero) if the viewport is valid, false(zero) otherwise
+ */
+static int parseViewport(char* text, Options* options)
+{
+    int values[4];
+    int ii, length;
+    int isValid = TRUE;
+
+    for (ii = 0; ii < 4 && isValid; ii++)
+    {
+        /* Every number but the last is followed by a comma */
+        length = 0;
+        while (text[length] != ',' && text[length] != '\0')
+        {
+            length++;
+        }
+        isValid = length > 0 && isInteger(text, length, &(values[ii])) &&
+                  (text[length] == ',') == (ii < 3);
+        text += length + 1;
+    }
+
+    if (isValid)
+    {
+        isValid = values[0] >= -MAX_COORDINATE && values[0] <= MAX_COORDINATE &&
+                  values[1] >= -MAX_COORDINATE && values[1] <= MAX_COORDINATE &&
+                  values[2] >= 1 && values[2] <= MAX_CANVAS_SIZE &&
+                  values[3] >= 1 && values[3] <= MAX_CANVAS_SIZE;
+        options->viewportLeft = values[0];
+        options->viewportTop = values[1];
+        options->viewportWidth = values[2];
+        options->viewportHeight = values[3];
+    }
+
+    return isValid;
+}
+
+/**
+ * Reads the Program from a compiled program file when the file is one, or from
+ * the cached copy of a text file with --cache, or otherwise by reading the
+ * text.
+ *
+ * Parameters:
+ *  fileName - the name of the file to read, or "-" for stdin
+ *  program  - (export) the Program of commands, or NULL on error
+ *  options  - the options given on the command line
+ *  errors   - the stream to print error messages to
+ * Returns:
+ *  the same error codes as readCommandsFromFile, or 9 if a compiled program
+ *  file is damaged or was compiled by a different version
+ */
+int loadProgram(char* fileName, Program** program, Options* options,
+                FILE* errors)
+{
+    int errNo;
+
+    if (isProgramFile(fileName))
+    {
+        errNo = readProgramFile(fileName, program, errors);
+    }
+    else if (options->isCached)
+    {
+        errNo = readCommandsCached(fileName, program, options->numThreads, errors);
+    }
+    else
+    {
+        errNo = readCommandsFromFile(fileName, program, options->numThreads,
+                                     errors);
+    }
+
+    return errNo;
+}
+
+/**
+ * A private function that writes the image of the drawing, to the output file
+ * when one was given or otherwise to the sink's stream. The image holds the
+ * viewport when one was given. Otherwise it starts from the top left of the
+ * terminal, reaching further up or left only for cells drawn there, and ends
+ * with the last row and column drawn.
+ *
+ * Parameters:
+ *  canvas  - the Canvas to write
+ *  options - the options given on the command line
+ *  sink    - where the drawing and the errors are written
+ * Returns:
+ *  the error code of Image_write, or 8 if the image would be more than
+ *  MAX_IMAGE_SIZE cells along a side
+ */
+static int writeImage(Canvas* canvas, Options* options, Sink* sink)
+{
+    int errNo;
+    int left = 0, top = 0, right = 0, bottom = 0;
+    int defaultFg, defaultBg;
+
+    if (options->viewportWidth > 0)
+    {
+        left = options->viewportLeft;
+        top = options->viewportTop;
+        right = left + options->viewportWidth - 1;
+        bottom = top + options->viewportHeight - 1;
+    }
+    else if (Canvas_getBounds(canvas, &left, &top, &right, &bottom))
+    {
+        left = left < 0 ? left : 0;
+        top = top < 0 ? top : 0;
+        right = right > 0 ? right : 0;
+        bottom = bottom > 0 ? bottom : 0;
+    }
+
+    /* Subtracted first so a drawing reaching both ends of an int fits */
+    if (right - MAX_IMAGE_SIZE >= left || bottom - MAX_IMAGE_SIZE >= top)
+    {
+        errNo = 8; /* Out of range */
+        fprintf(sink->errors, "ERROR: The drawing is too large for an image. "
+                "Please choose part of it with %s.\n", VIEWPORT_OPTION);
+    }
+    else
+    {
+        #ifdef NO_COLOURS
+        defaultFg = BLACK;
+        defaultBg = WHITE_BG;
+        #else
+        defaultFg = WHITE_FG;
+        defaultBg = BLACK;
+        #endif
+        if (options->outputName != NULL)
+        {
+            errNo = Image_write(canvas, left, top, right - left + 1, bottom - top + 1,
+                                options->outputName, options->scale, defaultFg,
+                                defaultBg, sink->errors);
+        }
+        else
+        {
+            errNo = Image_writeStream(canvas, left, top, right - left + 1,
+                                      bottom - top + 1, sink->output, sink->format,
+                                      options->scale, defaultFg, defaultBg,
+                                      sink->errors);
+        }
+    }
+
+    return errNo;
+}
+
+/**
+ * A private function that tells the user the input file could not be used.
+ *
+ * Parameters:
+ *  errors - the stream to print the message to
+ */
+static void printInvalidInput(FILE* errors)
+{
+    fprintf(errors, "ERROR: The input file is invalid. ");
+    fprintf(errors, "Please re-run the program with a valid input file.\n");
+}
+
+/**
+ * A private function that tells the user how to run the program.
+ */
+static void printUsage()
+{
+    fprintf(stderr, "ERROR: Invalid number of arguments. ");
+    fprintf(stderr, "Usage: ./TurtleGraphics [%s | %s | %s] [%s] "
+            "[%s <programFileName>] [%s] [%s <imageFileName> "
+            "[%s <pixels>]] [%s] [%s <left>,<top>,<width>,<height>] "
+            "[%s | %s] [%s <number>] <fileName>\n",
+            STREAM_OPTION, OPTIMISE_OPTION, OPTIMISE_RELAXED_OPTION,
+            CACHE_OPTION, COMPILE_OPTION, BINARY_LOG_OPTION, OUTPUT_OPTION,
+            SCALE_OPTION, UNBOUNDED_OPTION, VIEWPORT_OPTION, STATS_OPTION,
+            STATS_JSON_OPTION, THREADS_OPTION);
+    fprintf(stderr, "   or: ./TurtleGraphics %s <suffix> [%s <listFileName>] "
+            "[%s | %s] [%s] [%s] [%s <pixels>] [%s] "
+            "[%s <left>,<top>,<width>,<height>] [%s | %s] [%s <number>] "
+            "[<fileName> ...]\n",
+            BATCH_OPTION, MANIFEST_OPTION, OPTIMISE_OPTION,
+            OPTIMISE_RELAXED_OPTION, CACHE_OPTION, BINARY_LOG_OPTION,
+            SCALE_OPTION, UNBOUNDED_OPTION, VIEWPORT_OPTION, STATS_OPTION,
+            STATS_JSON_OPTION, THREADS_OPTION);
+    fprintf(stderr, "   or: ./TurtleGraphics %s <socketName> [%s | %s] [%s] "
+            "[%s <pixels>] [%s] [%s <left>,<top>,<width>,<height>] "
+            "[%s | %s] [%s <number>]\n",
+            SERVE_OPTION, OPTIMISE_OPTION, OPTIMISE_RELAXED_OPTION,
+            BINARY_LOG_OPTION, SCALE_OPTION, UNBOUNDED_OPTION, VIEWPORT_OPTION,
+            STATS_OPTION, STATS_JSON_OPTION, THREADS_OPTION);
+    fprintf(stderr, "   or: ./TurtleGraphics %s <logFileName>\n",
+            DECODE_LOG_OPTION);
 }
@@ -5,8 +5,78 @@
 #include "fileIO.h"
 #include "settings.h"
 #include "command.h"
-#include "linkedList.h"
+#include "program.h"
+#include "lineReader.h"
+#include "logWriter.h"
+#include "image.h"
+#include "stats.h"
+#include "optimiser.h"
+#include "programFile.h"
+#include "terminal.h"
 
-void executeCommands(LinkedList* cmdList);
+/**
+ * A struct which holds the options given on the command line. The output name
+ * is NULL when drawing in the terminal, the stats format is one of STATS_OFF,
+ * STATS_TEXT or STATS_JSON, zero threads means one per processor, and the
+ * optimise level is one of OPTIMISE_OFF, OPTIMISE_EXACT or OPTIMISE_RELAXED.
+ * The compile name is NULL unless the Program is to be compiled instead of
+ * drawn. The viewport width is zero unless a viewport was given. The batch
+ * suffix is NULL unless several files are drawn with --batch, and the manifest
+ * name is NULL unless it lists more of them. The socket name is NULL unless
+ * requests are served with --serve. The maximum executed is the number of
+ * commands, counting every repetition, a drawing may execute, or 0 for no limit.
+ */
+typedef struct
+{
+    int isStream;
+    int isBinaryLog;
+    int isDecodeLog;
+    char* outputName;
+    int scale;
+    int statsFormat;
+    int numThreads;
+    int optimiseLevel;
+    char* compileName;
+    int isCached;
+    int isUnbounded;
+    int viewportLeft;
+    int viewportTop;
+    int viewportWidth;
+    int viewportHeight;
+    char* batchSuffix;
+    char* manifestName;
+    char* socketName;
+    long maxExecuted;
+} Options;
+
+/**
+ * A struct representing where a drawing is written: the stream the terminal's
+ * escape codes go to, or the image in 'format' when it is not IMAGE_NONE, the
+ * stream its log goes to, or NULL to add to the log file, the stream its error
+ * messages go to, and the statistics it adds to. The canvas is NULL unless one
+ * is to be emptied and drawn on instead of creating a new one. Each drawing of
+ * a batch has its own.
+ */
+typedef struct
+{
+    FILE* output;
+    int format;
+    FILE* logFile;
+    FILE* errors;
+    Stats* stats;
+    Canvas* canvas;
+} Sink;
+
+int streamCommandsFromFile(char* fileName, Options* options, Sink* sink);
+
+void startDrawing(Terminal* terminal);
+
+void finishDrawing(Terminal* terminal);
+
+int executeCommands(Program* program, LineReader* stream, Options* options,
+                    Sink* sink);
+
+int loadProgram(char* fileName, Program** program, Options* options,
+                FILE* errors);
 
 #endif
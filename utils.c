@@ -1,9 +1,31 @@
+/* sysconf and pthreads are POSIX, not C89 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <limits.h>
 #include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
 #include "utils.h"
+#include "stats.h"
+
+/* The unit vectors of 0, 45, 90, ... 315 degrees */
+static const double EXACT_X[8] = { 1.0, SQRT_HALF, 0.0, -SQRT_HALF,
+                                   -1.0, -SQRT_HALF, 0.0, SQRT_HALF };
+static const double EXACT_Y[8] = { 0.0, SQRT_HALF, 1.0, SQRT_HALF,
+                                   0.0, -SQRT_HALF, -1.0, -SQRT_HALF };
+
+/* The unit vectors of every whole degree, built once by whichever thread needs
+ * them first */
+static double unitTableX[360];
+static double unitTableY[360];
+static pthread_once_t unitTableOnce = PTHREAD_ONCE_INIT;
+
+static void buildUnitTable();
 
 /**
  * Converts the character array to uppercase for easier comparison.
@@ -23,22 +45,25 @@ void convertToUpperCase(char string[])
 /**
  * Checks if a character array is a real number of type double. Uses 'strtod' to
  * verify that it is a double and HUGE_VAL to check for overflow of the datatype.
+ * The array does not need to end in '\0', but must be followed by a character
+ * that cannot be part of a number, such as whitespace.
  *
  * Parameters:
  *  cmdValue - the character array to check
+ *  length   - the number of characters to check
+ *  num      - (export) the converted double
  * Returns:
  *  true(non-zero) if it is a valid double, or false(zero) otherwise
  */
-int isReal(char cmdValue[])
+int isReal(char cmdValue[], int length, double* num)
 {
     int isReal;
     char* err;
-    double num;
 
     isReal = TRUE;
-    num = strtod(cmdValue, &err);
+    *num = strtod(cmdValue, &err);
     /* Overflow protection or NaN */
-    if (num == HUGE_VAL || num == -HUGE_VAL || *err != 0)
+    if (*num == HUGE_VAL || *num == -HUGE_VAL || err != cmdValue + length)
     {
         isReal = FALSE;
     }
@@ -48,23 +73,26 @@ int isReal(char cmdValue[])
 
 /**
  * Checks if a character array is an integer. Uses 'strtol' to verify that it is
- * an integer and INT_MAX and INT_MIN to check for overflow of the datatype.
+ * an integer and INT_MAX and INT_MIN to check for overflow of the datatype. The
+ * array does not need to end in '\0', but must be followed by a character that
+ * cannot be part of a number, such as whitespace.
  *
  * Parameters:
  *  cmdValue - the character array to check
+ *  length   - the number of characters to check
+ *  num      - (export) the converted integer
  * Returns:
  *  true(non-zero) if it is a valid integer, or false(zero) otherwise
  */
-int isInteger(char cmdValue[])
+int isInteger(char cmdValue[], int length, int* num)
 {
     int isInteger;
     char* err;
-    int num;
 
     isInteger = TRUE;
-    num = (int) strtol(cmdValue, &err, 10);
+    *num = (int) strtol(cmdValue, &err, 10);
     /* Overflow protection or NaN */
-    if (num == INT_MIN || num == INT_MAX || *err != 0)
+    if (*num == INT_MIN || *num == INT_MAX || err != cmdValue + length)
     {
         isInteger = FALSE;
     }
@@ -79,14 +107,15 @@ int isInteger(char cmdValue[])
  *
  * Parameters:
  *  cmdValue - the character array to check
+ *  length   - the number of characters in the array
  * Returns:
- *  true(non-zero) if the string length is one and that character is not a whitespace
+ *  true(non-zero) if the length is one and that character is not a whitespace
  *  character, false(zero) otherwise
  */
-int isCharacter(char cmdValue[])
+int isCharacter(char cmdValue[], int length)
 {
     /* A character is a string of length one that is not a whitespace character */
-    return strlen(cmdValue) == 1 && !isspace(cmdValue[0]);
+    return length == 1 && !isspace((unsigned char) cmdValue[0]);
 }
 
 /**
@@ -100,11 +129,37 @@ int isCharacter(char cmdValue[])
  */
 void polToRec(double d, double angle, double* x, double* y)
 {
+    STATS_COUNT(polToRecCalls, 1);
     /* sin and cos take in radians not degrees so times angle by PI/180 */
     *x = d * cos(angle * M_PI / 180.0);
     *y = d * sin(angle * M_PI / 180.0);
 }
 
+/**
+ * Converts an angle in degrees into the x and y of a unit vector pointing that
+ * way. Multiples of 45 degrees are exact, so repeated right-angle turns do not
+ * drift, and other whole degrees come from a table built on the first call.
+ * Anything else is worked out by polToRec.
+ *
+ * Parameters:
+ *  angle - the angle in degrees, from 0 up to but not including 360
+ *  x     - (export) the cosine of the angle
+ *  y     - (export) the sine of the angle
+ */
+void unitVector(double angle, double* x, double* y)
+{
+    pthread_once(&unitTableOnce, &buildUnitTable);
+    if (angle >= 0.0 && angle < 360.0 && angle == floor(angle))
+    {
+        *x = unitTableX[(int) angle];
+        *y = unitTableY[(int) angle];
+    }
+    else
+    {
+        polToRec(1.0, angle, x, y);
+    }
+}
+
 /**
  * Obtained from stackoverflow.com question 497018.
  * Rounds a real number of data-type double to the nearest whole number.
@@ -120,15 +175,81 @@ double roundNum(double n)
 }
 
 /**
- * Removes a newline character from the end of a string of length greater than 1.
+ * Divides one whole number by a positive one, rounding towards negative
+ * infinity rather than towards zero, so every block of 'divisor' numbers has
+ * the same quotient either side of zero. C89 leaves the rounding of negative
+ * quotients up to the compiler, so only positive numbers are ever divided.
+ *
+ * Parameters:
+ *  num     - the number to divide
+ *  divisor - the number to divide by, greater than zero
+ * Returns:
+ *  the largest whole number not greater than num / divisor
+ */
+int floorDivide(int num, int divisor)
+{
+    return num >= 0 ? num / divisor : -((-(num + 1)) / divisor) - 1;
+}
+
+/**
+ * Works out how many threads to use from the number asked for, where zero means
+ * one per processor. The result is from 1 to MAX_THREADS.
  *
  * Parameters:
- *  str - the string to remove the newline character from
+ *  numThreads - the number of threads asked for, or zero
+ * Returns:
+ *  the number of threads to use
  */
-void removeNewLineChar(char* str)
+int getNumThreads(int numThreads)
 {
-    if (strlen(str) > 0 && str[strlen(str) - 1] == '\n')
+    if (numThreads < 1)
+    {
+        numThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (numThreads < 1)
+    {
+        numThreads = 1;
+    }
+    else if (numThreads > MAX_THREADS)
+    {
+        numThreads = MAX_THREADS;
+    }
+
+    return numThreads;
+}
+
+/**
+ * Prints an error message followed by the reason for the last system error,
+ * the same way perror() does but to any stream.
+ *
+ * Parameters:
+ *  errors  - the stream to print to
+ *  message - the message to print before the reason
+ */
+void printSystemError(FILE* errors, char* message)
+{
+    char* reason = strerror(errno);
+
+    fprintf(errors, "%s: %s\n", message, reason);
+}
+
+/**
+ * A private function that fills the table of unit vectors used by unitVector().
+ */
+static void buildUnitTable()
+{
+    int ii;
+
+    for (ii = 0; ii < 360; ii++)
     {
-        str[strlen(str) - 1] = '\0';
+        if (ii % 45 == 0)
+        {
+            unitTableX[ii] = EXACT_X[ii / 45];
+            unitTableY[ii] = EXACT_Y[ii / 45];
+        }
+        else
+        {
+            polToRec(1.0, (double) ii, &unitTableX[ii], &unitTableY[ii]);
+        }
     }
 }
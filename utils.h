@@ -1,6 +1,7 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <stdio.h>
 #include "boolean.h"
 
 /* Define PI as math.h does not include it in C89 */
@@ -8,18 +9,30 @@
 #define M_PI 3.14159265358979323846
 #endif
 
+/* The sine and cosine of 45 degrees */
+#define SQRT_HALF 0.70710678118654752440
+
+/* Most threads used for any one job */
+#define MAX_THREADS 64
+
 void convertToUpperCase(char string[]);
 
-int isReal(char cmdValue[]);
+int isReal(char cmdValue[], int length, double* num);
 
-int isInteger(char cmdValue[]);
+int isInteger(char cmdValue[], int length, int* num);
 
-int isCharacter(char cmdValue[]);
+int isCharacter(char cmdValue[], int length);
 
 void polToRec(double d, double angle, double* x, double* y);
 
+void unitVector(double angle, double* x, double* y);
+
 double roundNum(double n);
 
-void removeNewLineChar(char* str);
+int floorDivide(int num, int divisor);
+
+int getNumThreads(int numThreads);
+
+void printSystemError(FILE* errors, char* message);
 
 #endif
\ No newline at end of file